@@ -0,0 +1,1033 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include <SFML/System/Time.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "EffectLibrary.h"
+#include "Noise.h"
+#include "ParticleEmitter.h"
+#include "ParticleSnapshot.h"
+#include "ParticleSystem.h"
+#include "Randomizer.h"
+#include "SceneRecording.h"
+#include "SimdKernels.h"
+
+#ifdef PARTICLES_BENCH_RENDER
+#include "ParticleRenderer.h"
+#endif
+
+/**
+ * Headless benchmark of the particle system. Before running, the SIMD kernels are checked bit-for-bit against the
+ * scalar path, and a recording of effects spawned out of their compile order is replayed (exit code 1 on mismatch).
+ * Every scenario runs with a fixed seed and a fixed timestep so two runs of the same binary do the exact same work,
+ * and each update stage is timed on its own:
+ *
+ * - emit: ParticleSystem::UpdateEmitters, per spawned particle
+ * - kill: ParticleSystem::KillParticles, per particle tested ("-stable" and "-swap" scenarios change the KillMode)
+ * - collide: ParticleSystem::Collide, per particle integrated ("collision-" scenarios add surfaces)
+ * - update: ParticleSystem::Integrate, per particle integrated
+ * - vertex: ParticleRenderer::Update, per particle drawn ("-fused" scenarios build them in update and emit instead,
+ *   "curves-" scenarios apply lifetime curves to the colors, "quads-" ones build rotated textured quads)
+ *
+ * particles_bench only links the simulation core, it leaves the vertex column empty and skips the "-fused",
+ * "curves-" and "quads-" scenarios. particles_bench_render is the same benchmark with the render layer
+ * (PARTICLES_BENCH_RENDER), it runs them all and times the vertex build.
+ *
+ * The "spam-" scenarios overflow a pool of 100k particles and report the spawns dropped or recycled by the
+ * OverflowPolicy. The "noise" line times Noise::Evaluate over 1M particle positions and the "affector" lines time
+ * ParticleSystem::ApplyAffectors with each affector alone, then all of them, over 1M particles. The "grid" line times
+ * the SpatialGrid rebuild and radius queries at 1M particles, against a brute force scan of the same queries. The
+ * "snapshot" line saves 10M particles with ParticleSnapshot and times the load back. The "effect" line times the spawn
+ * of the click burst from setters (SpawnEmitter) against its recipe compiled once (SpawnEffect).
+ *
+ * ```
+ * particles_bench                  // run all the scenarios
+ * particles_bench steady burst     // only run the scenarios whose name contains one of the arguments
+ * particles_bench --seed 7         // change the seed
+ * particles_bench --threads 0      // split the stages over a worker pool, 0 uses all the cores (default: 1)
+ * particles_bench --replay a.prec  // time the replay of a recorded session instead (see SceneRecording), exit
+ *                                  // code 1 if it doesn't end in the recorded state
+ * particles_bench --snapshot a.psnp // time frames from a saved state instead (see ParticleSnapshot)
+ * ```
+ */
+
+namespace
+{
+    constexpr unsigned SCREEN_WIDTH = 1920u;
+    constexpr unsigned SCREEN_HEIGHT = 1080u;
+    constexpr unsigned DEFAULT_SEED = 42u;
+
+    // Same rate as the frame limit of the sandbox window
+    const sf::Time TIMESTEP = sf::seconds(1.f / 144.f);
+
+    using Clock = std::chrono::steady_clock;
+
+    struct StageTotals
+    {
+        double emitNs = 0.0;
+        double killNs = 0.0;
+        double collideNs = 0.0;
+        double updateNs = 0.0;
+        double vertexNs = 0.0;
+
+        unsigned long long spawned = 0;
+        unsigned long long killed = 0;
+        unsigned long long tested = 0;
+        unsigned long long integrated = 0;
+        unsigned long long vertices = 0;
+
+        unsigned long long dropped = 0;
+        unsigned long long recycled = 0;
+        unsigned long long collisions = 0;
+    };
+
+    struct Scenario
+    {
+        const char *name;
+        int frames;
+        unsigned reserve;
+        void (*setup)(ParticleSystem &system);
+        KillMode killMode = KillMode::Compact;
+        bool fusedVertexBuild = false;
+        OverflowPolicy overflowPolicy = OverflowPolicy::Grow;
+        // Called before every frame when set
+        void (*everyFrame)(ParticleSystem &system, int frame) = nullptr;
+        // Textured quads instead of points, only in particles_bench_render
+        bool quads = false;
+    };
+
+    double ElapsedNs(const Clock::time_point &start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    double PerParticle(const double ns, const unsigned long long count)
+    {
+        return count > 0 ? ns / static_cast<double>(count) : 0.0;
+    }
+
+    // Long-lived, slow particles spread over the screen, nothing expires during the run
+    void FillSteadyState(ParticleSystem &system, const unsigned count)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            const sf::Vector2f position = Randomizer::RandomVector(0.f, SCREEN_WIDTH, 0.f, SCREEN_HEIGHT);
+            const sf::Vector2f velocity = Randomizer::RandomVector(-1.f, 1.f, -1.f, 1.f);
+            system.SpawnParticle(position, velocity, ParticleColor::White, 1000.f);
+        }
+    }
+
+#ifdef PARTICLES_BENCH_RENDER
+    // 1M particles from one emitter with color, alpha and scale curves and spinning quads, emitted during the setup.
+    // They live 2 to 4 seconds so they spread over the whole curves without expiring during the run.
+    void SetupLifetimeCurves(ParticleSystem &system)
+    {
+        ParticleEmitter fade(sf::Vector2f(SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f));
+        fade.SetDuration(1.5f * TIMESTEP.asSeconds());
+        fade.SetEmissionRate(1.f / TIMESTEP.asSeconds());
+        fade.SetVelocity(10.f, 200.f);
+        fade.SetLifetime(2.f, 4.f);
+        fade.SetParticlesPerEmission(1000000);
+        fade.SetColorOverLifetime(ParticleColor::Yellow, ParticleColor::Red);
+        fade.SetAlphaOverLifetime(1.f, 0.f);
+        fade.SetScaleOverLifetime(1.f, 3.f);
+        fade.SetSize(2.f, 6.f);
+        fade.SetRotation(0.f, static_cast<float>(2 * M_PI));
+        fade.SetSpin(-3.f, 3.f);
+        system.SpawnEmitter(fade);
+        system.UpdateEmitters(sf::seconds(1.5f * TIMESTEP.asSeconds()));
+    }
+#endif
+
+    // The five emitters spawned on every mouse click in main.cpp
+    void SpawnClickBurst(ParticleSystem &system, const sf::Vector2f &position)
+    {
+        ParticleEmitter smoke(position);
+        smoke.SetColor(ParticleColor::White);
+        smoke.SetDuration(5.f);
+        smoke.SetEmissionRate(5.f);
+        smoke.SetVelocity(5.f, 10.f);
+        smoke.SetLifetime(2.f, 5.f);
+        smoke.SetParticlesPerEmission(200);
+        system.SpawnEmitter(smoke);
+        ParticleEmitter yellow(position);
+        yellow.SetColor(ParticleColor::Yellow);
+        yellow.SetDuration(.5f);
+        yellow.SetEmissionRate(5.f);
+        yellow.SetVelocity(1.f, 50.f);
+        yellow.SetLifetime(.1f, .5f);
+        yellow.SetParticlesPerEmission(200);
+        system.SpawnEmitter(yellow);
+        ParticleEmitter orange(position);
+        orange.SetColor(ParticleColor::Red);
+        orange.SetDuration(.5f);
+        orange.SetEmissionRate(3.f);
+        orange.SetVelocity(1.f, 50.f);
+        orange.SetLifetime(.1f, .5f);
+        orange.SetParticlesPerEmission(200);
+        system.SpawnEmitter(orange);
+        ParticleEmitter fire(position);
+        fire.SetColor(ParticleColor::Magenta);
+        fire.SetDuration(.1f);
+        fire.SetEmissionRate(100.f);
+        fire.SetVelocity(1.f, 50.f);
+        fire.SetLifetime(.1f, .5f);
+        fire.SetParticlesPerEmission(200);
+        system.SpawnEmitter(fire);
+        ParticleEmitter blast(position);
+        blast.SetColor(ParticleColor::Cyan);
+        blast.SetDuration(1.f / 100.f);
+        blast.SetEmissionRate(1000.f);
+        blast.SetVelocity(495.f, 505.f);
+        blast.SetLifetime(1.f, 2.f);
+        blast.SetParticlesPerEmission(3000);
+        system.SpawnEmitter(blast);
+    }
+
+    // SpawnClickBurst as a recipe of EffectLibrary
+    const char *const CLICK_BURST_RECIPE = R"(
+[burst.smoke]
+color = #FFFFFF
+duration = 5
+emissionRate = 5
+velocity = 5 10
+lifetime = 2 5
+particlesPerEmission = 200
+[burst.yellow]
+color = #FFFF00
+duration = 0.5
+emissionRate = 5
+velocity = 1 50
+lifetime = 0.1 0.5
+particlesPerEmission = 200
+[burst.orange]
+color = #FF0000
+duration = 0.5
+emissionRate = 3
+velocity = 1 50
+lifetime = 0.1 0.5
+particlesPerEmission = 200
+[burst.fire]
+color = #FF00FF
+duration = 0.1
+emissionRate = 100
+velocity = 1 50
+lifetime = 0.1 0.5
+particlesPerEmission = 200
+[burst.blast]
+color = #00FFFF
+duration = 0.01
+emissionRate = 1000
+velocity = 495 505
+lifetime = 1 2
+particlesPerEmission = 3000
+)";
+
+    // Two effects with their own curves and colors, for the replay check
+    const char *const CURVED_EFFECTS_RECIPE = R"(
+[fade.sparks]
+color = #FFB86C
+duration = 0.5
+emissionRate = 20
+velocity = 10 80
+lifetime = 0.5 1
+particlesPerEmission = 50
+alphaOverLifetime = 1 0
+[grow.smoke]
+color = #8BE9FD
+duration = 0.5
+emissionRate = 20
+velocity = 5 20
+lifetime = 0.5 1
+particlesPerEmission = 50
+scaleOverLifetime = 1 3
+colorOverLifetime = #FFFFFF #6272A4
+)";
+
+    // About 1M particles living at most half a second, refilled every frame: a large share dies each frame
+    void SetupKillChurn(ParticleSystem &system)
+    {
+        for (unsigned i = 0; i < 1000000; ++i)
+        {
+            const sf::Vector2f position = Randomizer::RandomVector(0.f, SCREEN_WIDTH, 0.f, SCREEN_HEIGHT);
+            const sf::Vector2f velocity = Randomizer::RandomVector(-50.f, 50.f, -50.f, 50.f);
+            system.SpawnParticle(position, velocity, ParticleColor::White, Randomizer::RandomFloat(0.f, .5f));
+        }
+
+        ParticleEmitter refill(sf::Vector2f(SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f));
+        refill.SetDuration(1000.f);
+        refill.SetEmissionRate(144.f);
+        refill.SetVelocity(10.f, 400.f);
+        refill.SetLifetime(0.f, .5f);
+        refill.SetParticlesPerEmission(4000000 / 144);
+        system.SpawnEmitter(refill);
+    }
+
+    // 1M particles in blasts of 3000 sharing the same lifetime, a tenth of them expire in the same frame every 50ms
+    void SetupMassExpiry(ParticleSystem &system)
+    {
+        for (unsigned i = 0; i < 1000000; ++i)
+        {
+            const sf::Vector2f position = Randomizer::RandomVector(0.f, SCREEN_WIDTH, 0.f, SCREEN_HEIGHT);
+            const sf::Vector2f velocity = Randomizer::RandomVector(-1.f, 1.f, -1.f, 1.f);
+            const float lifeTime = static_cast<float>(i / 3000 % 10 + 1) * .05f;
+            system.SpawnParticle(position, velocity, ParticleColor::White, lifeTime);
+        }
+    }
+
+    // A user spamming clicks: a new burst at a different place 8 times per second
+    void SpamClicks(ParticleSystem &system, const int frame)
+    {
+        if (frame % 18 == 0)
+        {
+            const float x = SCREEN_WIDTH * (.2f + .6f * static_cast<float>(frame % 90) / 90.f);
+            SpawnClickBurst(system, {x, SCREEN_HEIGHT / 2.f});
+        }
+    }
+
+    // Thousands of short-lived emitters: 200 new ones every frame, each living 50ms
+    void SpawnEmitterChurn(ParticleSystem &system, const int frame)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            ParticleEmitter spark({SCREEN_WIDTH * static_cast<float>(i) / 200.f, SCREEN_HEIGHT * (frame % 10) / 10.f});
+            spark.SetDuration(.05f);
+            spark.SetEmissionRate(60.f);
+            spark.SetVelocity(10.f, 100.f);
+            spark.SetLifetime(.1f, .3f);
+            spark.SetParticlesPerEmission(4);
+            system.SpawnEmitter(spark);
+        }
+    }
+
+    // 1M fast particles between 100 random segments and 20 boxes, the surfaces use the given material
+    void SetupCollisions(ParticleSystem &system, const SurfaceMaterial &material)
+    {
+        CollisionSurfaces &surfaces = system.GetCollisionSurfaces();
+        for (int i = 0; i < 100; ++i)
+        {
+            const sf::Vector2f a = Randomizer::RandomVector(0.f, SCREEN_WIDTH, 0.f, SCREEN_HEIGHT);
+            surfaces.AddSegment(a, a + Randomizer::RandomVector(-100.f, 100.f, -100.f, 100.f), material);
+        }
+        for (int i = 0; i < 20; ++i)
+        {
+            surfaces.AddBox(Randomizer::RandomVector(0.f, SCREEN_WIDTH - 100.f, 0.f, SCREEN_HEIGHT - 100.f),
+                            Randomizer::RandomVector(20.f, 100.f, 20.f, 100.f), material);
+        }
+
+        for (unsigned i = 0; i < 1000000; ++i)
+        {
+            const sf::Vector2f position = Randomizer::RandomVector(0.f, SCREEN_WIDTH, 0.f, SCREEN_HEIGHT);
+            const sf::Vector2f velocity = Randomizer::RandomVector(-300.f, 300.f, -300.f, 300.f);
+            system.SpawnParticle(position, velocity, ParticleColor::White, 1000.f);
+        }
+    }
+
+    const std::vector<Scenario> SCENARIOS = {
+            {"steady-100k", 500, 100000, [](ParticleSystem &system) { FillSteadyState(system, 100000); }},
+            {"steady-1m", 100, 1000000, [](ParticleSystem &system) { FillSteadyState(system, 1000000); }},
+            {"steady-10m", 10, 10000000, [](ParticleSystem &system) { FillSteadyState(system, 10000000); }},
+#ifdef PARTICLES_BENCH_RENDER
+            {"steady-1m-fused", 100, 1000000, [](ParticleSystem &system) { FillSteadyState(system, 1000000); },
+             KillMode::Compact, true},
+            {"curves-1m", 100, 1000000, SetupLifetimeCurves},
+            {"curves-1m-fused", 100, 1000000, SetupLifetimeCurves, KillMode::Compact, true},
+            {"quads-1m", 100, 1000000, SetupLifetimeCurves, KillMode::Compact, false, OverflowPolicy::Grow, nullptr,
+             true},
+#endif
+            {"click-burst", 720, 100000,
+             [](ParticleSystem &system) { SpawnClickBurst(system, {SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f}); }},
+            {"kill-churn", 144, 1000000, SetupKillChurn},
+            {"kill-churn-stable", 144, 1000000, SetupKillChurn, KillMode::CompactStable},
+            {"kill-churn-swap", 144, 1000000, SetupKillChurn, KillMode::SwapAndPop},
+            {"mass-expiry", 80, 1000000, SetupMassExpiry},
+            {"mass-expiry-stable", 80, 1000000, SetupMassExpiry, KillMode::CompactStable},
+            {"mass-expiry-swap", 80, 1000000, SetupMassExpiry, KillMode::SwapAndPop},
+            {"emitter-churn", 720, 100000, [](ParticleSystem &) {}, KillMode::Compact, false, OverflowPolicy::Grow,
+             SpawnEmitterChurn},
+            // Click spam in a pool of 100k particles, for each overflow policy
+            {"spam-grow", 720, 100000, [](ParticleSystem &) {}, KillMode::Compact, false, OverflowPolicy::Grow,
+             SpamClicks},
+            {"spam-drop", 720, 100000, [](ParticleSystem &) {}, KillMode::Compact, false, OverflowPolicy::DropNew,
+             SpamClicks},
+            {"spam-oldest", 720, 100000, [](ParticleSystem &) {}, KillMode::Compact, false,
+             OverflowPolicy::RecycleOldest, SpamClicks},
+            {"spam-shortest", 720, 100000, [](ParticleSystem &) {}, KillMode::Compact, false,
+             OverflowPolicy::RecycleShortestLife, SpamClicks},
+            {"collision-bounce", 100, 1000000, [](ParticleSystem &system) { SetupCollisions(system, {}); }},
+            {"collision-kill", 100, 1000000,
+             [](ParticleSystem &system) { SetupCollisions(system, {CollisionResponse::Kill}); }},
+    };
+
+    // The vertex build of the render layer, does nothing in particles_bench
+    class VertexStage
+    {
+    public:
+        explicit VertexStage(const bool quads = false)
+        {
+#ifdef PARTICLES_BENCH_RENDER
+            _renderer.SetMode(quads ? RenderMode::TexturedQuads : RenderMode::Points);
+#else
+            (void)quads;
+#endif
+        }
+
+        void Run(const ParticleSystem &system, StageTotals &totals)
+        {
+#ifdef PARTICLES_BENCH_RENDER
+            const auto start = Clock::now();
+            _renderer.Update(system);
+            totals.vertexNs += ElapsedNs(start);
+            totals.vertices += system.GetNumberOfParticles();
+#else
+            (void)system;
+            (void)totals;
+#endif
+        }
+
+    private:
+#ifdef PARTICLES_BENCH_RENDER
+        ParticleRenderer _renderer;
+#endif
+    };
+
+    // One step of the update, the stages in the order of ParticleSystem::Update (without the grid and the affectors,
+    // the scenarios have none) and the vertex build, each timed on its own
+    void RunTimedStep(ParticleSystem &system, VertexStage &vertexStage, const sf::Time &timestep, StageTotals &totals)
+    {
+        const auto beforeKill = system.GetNumberOfParticles();
+        auto start = Clock::now();
+        system.KillParticles();
+        totals.killNs += ElapsedNs(start);
+        totals.tested += beforeKill;
+
+        const auto alive = system.GetNumberOfParticles();
+        totals.killed += beforeKill - alive;
+        start = Clock::now();
+        system.Collide(timestep);
+        totals.collideNs += ElapsedNs(start);
+        totals.collisions += system.GetNumberOfCollisions();
+
+        start = Clock::now();
+        system.Integrate(timestep);
+        totals.updateNs += ElapsedNs(start);
+        totals.integrated += alive;
+
+        // Particles recycled to make room were replaced by new ones
+        const auto recycledBefore = system.GetRecycledParticles();
+        start = Clock::now();
+        system.UpdateEmitters(timestep);
+        totals.emitNs += ElapsedNs(start);
+        totals.spawned += system.GetNumberOfParticles() - alive + system.GetRecycledParticles() - recycledBefore;
+
+        vertexStage.Run(system, totals);
+    }
+
+    StageTotals RunScenario(const Scenario &scenario, const unsigned seed, const unsigned threads)
+    {
+        Randomizer::Seed(seed);
+
+        ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+        system.Initialize(scenario.reserve);
+        system.SetKillMode(scenario.killMode);
+        system.SetThreadCount(threads);
+        system.SetFusedVertexBuild(scenario.fusedVertexBuild);
+        system.SetOverflowPolicy(scenario.overflowPolicy);
+        VertexStage vertexStage(scenario.quads);
+        scenario.setup(system);
+
+        StageTotals totals;
+        for (int frame = 0; frame < scenario.frames; ++frame)
+        {
+            if (scenario.everyFrame)
+            {
+                scenario.everyFrame(system, frame);
+            }
+
+            RunTimedStep(system, vertexStage, TIMESTEP, totals);
+        }
+
+        totals.dropped = system.GetDroppedSpawns();
+        totals.recycled = system.GetRecycledParticles();
+
+        return totals;
+    }
+
+    void PrintHeader()
+    {
+        std::printf("%-18s %7s %12s %12s %11s %11s %12s %11s %11s %10s %10s %10s\n", "scenario", "frames",
+                    "avg alive", "killed", "emit ns/p", "kill ns/p", "collide ns/p", "update ns/p", "vertex ns/p",
+                    "dropped", "recycled", "collisions");
+    }
+
+    void PrintTotals(const char *name, const unsigned long long frames, const StageTotals &totals)
+    {
+        // Empty without the render layer
+        char vertex[32] = "-";
+        if (totals.vertices > 0)
+        {
+            std::snprintf(vertex, sizeof(vertex), "%.3f", PerParticle(totals.vertexNs, totals.vertices));
+        }
+        std::printf("%-18s %7llu %12llu %12llu %11.3f %11.3f %12.3f %11.3f %11s %10llu %10llu %10llu\n", name, frames,
+                    frames > 0 ? totals.integrated / frames : 0, totals.killed,
+                    PerParticle(totals.emitNs, totals.spawned), PerParticle(totals.killNs, totals.tested),
+                    PerParticle(totals.collideNs, totals.integrated), PerParticle(totals.updateNs, totals.integrated),
+                    vertex, totals.dropped, totals.recycled, totals.collisions);
+    }
+
+    // Replay a recorded session (see SceneRecording) with every step timed, then check that it ended in the recorded
+    // state. Returns false if the file can't be loaded or the state differs.
+    bool RunReplay(const std::string &path, const unsigned threads)
+    {
+        SceneRecording recording;
+        if (!recording.Load(path))
+        {
+            std::printf("replay %s: can't load the recording\n", path.c_str());
+            return false;
+        }
+
+        SceneReplay replay(recording);
+        const auto system = recording.CreateSystem();
+        system->SetThreadCount(threads);
+        VertexStage vertexStage;
+
+        std::printf("replay %s: %zu spawns, %llu steps of %.6fs, seed %u, threads %u\n", path.c_str(),
+                    recording.GetSpawns().size(), static_cast<unsigned long long>(recording.GetStepCount()),
+                    recording.GetTimestep().asSeconds(), recording.GetSeed(), threads);
+        PrintHeader();
+        StageTotals totals;
+        while (replay.NextStep(*system))
+        {
+            RunTimedStep(*system, vertexStage, recording.GetTimestep(), totals);
+        }
+        totals.dropped = system->GetDroppedSpawns();
+        totals.recycled = system->GetRecycledParticles();
+
+        PrintTotals("replay", recording.GetStepCount(), totals);
+        const bool identical = SceneRecording::ComputeChecksum(system->GetParticles()) == recording.GetChecksum();
+        std::printf("replay %s: final state %s\n", path.c_str(), identical ? "identical" : "MISMATCH");
+        return identical;
+    }
+
+    // Time frames starting from a saved state (see ParticleSnapshot), a fixture of a real scene. Returns false if the
+    // file can't be loaded.
+    bool RunSnapshot(const std::string &path, const unsigned threads)
+    {
+        constexpr unsigned long long frames = 100;
+        ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+        system.SetThreadCount(threads);
+        const auto start = Clock::now();
+        if (!ParticleSnapshot::Load(system, path))
+        {
+            std::printf("snapshot %s: can't load the state\n", path.c_str());
+            return false;
+        }
+        const double loadNs = ElapsedNs(start);
+        system.Initialize(static_cast<unsigned>(system.GetNumberOfParticles()));
+        VertexStage vertexStage;
+
+        std::printf("snapshot %s: %llu particles, %zu emitters, loaded in %.2f ms, threads %u\n", path.c_str(),
+                    system.GetNumberOfParticles(), system.GetNumberOfEmitters(), loadNs / 1e6, threads);
+        PrintHeader();
+        StageTotals totals;
+        for (unsigned long long frame = 0; frame < frames; ++frame)
+        {
+            RunTimedStep(system, vertexStage, TIMESTEP, totals);
+        }
+        totals.dropped = system.GetDroppedSpawns();
+        totals.recycled = system.GetRecycledParticles();
+        PrintTotals("snapshot", frames, totals);
+        return true;
+    }
+
+    // Save 10M particles to a file and time the load back into another system, the checksums check the round trip
+    void PrintSnapshotTiming()
+    {
+        constexpr unsigned count = 10000000;
+        constexpr int loads = 5;
+        const std::string path = "particles_bench.psnp";
+        ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+        system.Initialize(count);
+        FillSteadyState(system, count);
+
+        auto start = Clock::now();
+        const bool saved = ParticleSnapshot::Save(system, path);
+        const double saveNs = ElapsedNs(start);
+
+        // The first load allocates the arrays, the next ones reuse them
+        ParticleSystem loaded(SCREEN_WIDTH, SCREEN_HEIGHT);
+        start = Clock::now();
+        bool ok = saved && ParticleSnapshot::Load(loaded, path);
+        const double firstNs = ElapsedNs(start);
+        double loadNs = 0.0;
+        for (int load = 0; ok && load < loads; ++load)
+        {
+            start = Clock::now();
+            ok = ParticleSnapshot::Load(loaded, path);
+            loadNs += ElapsedNs(start);
+        }
+        std::remove(path.c_str());
+
+        double bytes = 0.0;
+        loaded.GetParticles().ForEachArray([&bytes](const auto &array)
+                                           { bytes += static_cast<double>(array.size() * sizeof(array[0])); });
+        ok = ok && SceneRecording::ComputeChecksum(system.GetParticles()) ==
+                           SceneRecording::ComputeChecksum(loaded.GetParticles());
+        std::printf("snapshot 10M particles (%.0f MB): save %.1f ms, first load %.1f ms, load %.1f ms (%.2f GB/s), "
+                    "round trip %s\n",
+                    bytes / 1e6, saveNs / 1e6, firstNs / 1e6, loadNs / loads / 1e6, bytes * loads / loadNs,
+                    ok ? "ok" : "MISMATCH");
+    }
+
+    // Spawn the click burst many times from its setters, then from its compiled recipe. The emitters aren't updated,
+    // only the spawn is timed; a new system every round keeps the pool small.
+    void PrintEffectTiming()
+    {
+        constexpr int rounds = 500;
+        // 200 bursts of 5 emitters, within the 1024 emitters the pool reserves even with Initialize(0), which reserves
+        // no particle (the emitters aren't updated)
+        constexpr int spawns = 200;
+        std::map<std::string, EffectLibrary::Recipe> recipes;
+        std::istringstream stream(CLICK_BURST_RECIPE);
+        std::string error;
+        if (!EffectLibrary::Parse(stream, recipes, error))
+        {
+            std::printf("effect: recipe error %s\n", error.c_str());
+            return;
+        }
+
+        double settersNs = 0.0;
+        double effectNs = 0.0;
+        size_t settersEmitters = 0;
+        size_t effectEmitters = 0;
+        for (int round = 0; round < rounds; ++round)
+        {
+            ParticleSystem setters(SCREEN_WIDTH, SCREEN_HEIGHT);
+            setters.Initialize(0);
+            auto start = Clock::now();
+            for (int spawn = 0; spawn < spawns; ++spawn)
+            {
+                SpawnClickBurst(setters, {static_cast<float>(spawn), SCREEN_HEIGHT / 2.f});
+            }
+            settersNs += ElapsedNs(start);
+            settersEmitters += setters.GetNumberOfEmitters();
+
+            ParticleSystem compiled(SCREEN_WIDTH, SCREEN_HEIGHT);
+            compiled.Initialize(0);
+            const EffectTemplate effect = compiled.CompileEffect(recipes["burst"]);
+            start = Clock::now();
+            for (int spawn = 0; spawn < spawns; ++spawn)
+            {
+                compiled.SpawnEffect(effect, {static_cast<float>(spawn), SCREEN_HEIGHT / 2.f});
+            }
+            effectNs += ElapsedNs(start);
+            effectEmitters += compiled.GetNumberOfEmitters();
+        }
+
+        std::printf("effect click burst: setters %.0f ns, compiled %.0f ns per spawn, emitters %s\n",
+                    settersNs / (rounds * spawns), effectNs / (rounds * spawns),
+                    settersEmitters == effectEmitters ? "ok" : "MISMATCH");
+    }
+
+    // Record effects compiled before the recording and spawned in the other order, then check that the replay ends in
+    // the recorded state: the curves and the colors are registered by the compilation, not by the spawns
+    bool CheckEffectReplay()
+    {
+        std::map<std::string, EffectLibrary::Recipe> recipes;
+        std::istringstream stream(CURVED_EFFECTS_RECIPE);
+        std::string error;
+        if (!EffectLibrary::Parse(stream, recipes, error))
+        {
+            std::printf("replay check: recipe error %s\n", error.c_str());
+            return false;
+        }
+
+        ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+        system.Initialize(100000);
+        system.SetFixedTimestep(144.f);
+        const EffectTemplate fade = system.CompileEffect(recipes["fade"]);
+        const EffectTemplate grow = system.CompileEffect(recipes["grow"]);
+
+        SceneRecording recording;
+        if (!recording.Start(system, 7))
+        {
+            std::printf("replay check: can't start the recording\n");
+            return false;
+        }
+        system.SetRecording(&recording);
+        for (int step = 0; step < 100; ++step)
+        {
+            if (step == 0)
+            {
+                system.SpawnEffect(grow, {SCREEN_WIDTH / 3.f, SCREEN_HEIGHT / 2.f});
+            }
+            if (step == 10)
+            {
+                system.SpawnEffect(fade, {SCREEN_WIDTH * 2.f / 3.f, SCREEN_HEIGHT / 2.f});
+            }
+            system.Update(recording.GetTimestep());
+        }
+        system.SetRecording(nullptr);
+        recording.Finish(system);
+
+        const bool identical = SceneReplay(recording).Run() == recording.GetChecksum();
+        std::printf("replay check effects %s\n", identical ? "ok" : "MISMATCH");
+        return identical;
+    }
+
+    // Run every supported SIMD level on the same data as the scalar path and compare the results bit-for-bit
+    bool CheckSimdKernels()
+    {
+        // Odd count so the tails are exercised too, boundary and out of bounds values included
+        constexpr size_t count = 1037;
+        std::vector<float> positions(count * 2);
+        std::vector<float> velocities(count * 2);
+        std::vector<float> timeRemainder(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            positions[i * 2] = Randomizer::RandomFloat(-10.f, SCREEN_WIDTH + 10.f);
+            positions[i * 2 + 1] = Randomizer::RandomFloat(-10.f, SCREEN_HEIGHT + 10.f);
+            velocities[i * 2] = Randomizer::RandomFloat(-500.f, 500.f);
+            velocities[i * 2 + 1] = Randomizer::RandomFloat(-500.f, 500.f);
+            timeRemainder[i] = Randomizer::RandomFloat(-.1f, 1.f);
+        }
+        positions[0] = 0.f;
+        positions[3] = SCREEN_HEIGHT;
+        timeRemainder[5] = 0.f;
+
+        const auto run = [&](const SimdLevel level, std::vector<float> &outPositions, std::vector<float> &outTime,
+                             std::vector<unsigned char> &outMask)
+        {
+            SimdKernels::SetLevel(level);
+            outPositions = positions;
+            outTime = timeRemainder;
+            outMask.assign(count, 2);
+            SimdKernels::ComputeAliveMask(outPositions.data(), outTime.data(), outMask.data(), count, SCREEN_WIDTH,
+                                          SCREEN_HEIGHT);
+            SimdKernels::Integrate(outPositions.data(), velocities.data(), outTime.data(), count, TIMESTEP.asSeconds());
+        };
+
+        std::vector<float> scalarPositions, scalarTime, simdPositions, simdTime;
+        std::vector<unsigned char> scalarMask, simdMask;
+        run(SimdLevel::Scalar, scalarPositions, scalarTime, scalarMask);
+
+        // Fractal noise over the same positions, negative coordinates included
+        const Noise noise(DEFAULT_SEED);
+        const NoiseSettings noiseSettings{.013f, 3, 2.f, .5f};
+        const auto runNoise = [&](const SimdLevel level, std::vector<float> &outValues)
+        {
+            SimdKernels::SetLevel(level);
+            outValues.assign(count, 0.f);
+            noise.Evaluate(reinterpret_cast<const sf::Vector2f *>(positions.data()), outValues.data(), count, 1.7f,
+                           noiseSettings);
+        };
+
+        std::vector<float> scalarNoise, simdNoise;
+        runNoise(SimdLevel::Scalar, scalarNoise);
+
+        bool ok = true;
+        const auto supported = static_cast<int>(SimdKernels::GetSupportedLevel());
+        for (auto level = static_cast<int>(SimdLevel::SSE2); level <= supported; ++level)
+        {
+            run(static_cast<SimdLevel>(level), simdPositions, simdTime, simdMask);
+            runNoise(static_cast<SimdLevel>(level), simdNoise);
+            const bool same =
+                    std::memcmp(scalarPositions.data(), simdPositions.data(), count * 2 * sizeof(float)) == 0 &&
+                    std::memcmp(scalarTime.data(), simdTime.data(), count * sizeof(float)) == 0 &&
+                    scalarMask == simdMask &&
+                    std::memcmp(scalarNoise.data(), simdNoise.data(), count * sizeof(float)) == 0;
+            std::printf("simd check %-6s %s\n", SimdKernels::GetLevelName(static_cast<SimdLevel>(level)),
+                        same ? "ok" : "MISMATCH");
+            ok = ok && same;
+        }
+
+        SimdKernels::SetLevel(SimdKernels::GetSupportedLevel());
+        return ok;
+    }
+
+    // Compare the separate and the fused vertex build at 1M particles. Both read and write the same particle data
+    // and vertices, except that the separate loop reads the positions a second time from memory (the colors are
+    // read once in both cases), so the traffic saved is one sf::Vector2f per particle and per frame.
+    void PrintFusedComparison(const std::vector<std::pair<std::string, StageTotals>> &results)
+    {
+        const StageTotals *separate = nullptr;
+        const StageTotals *fused = nullptr;
+        for (const auto &[name, totals] : results)
+        {
+            separate = name == "steady-1m" ? &totals : separate;
+            fused = name == "steady-1m-fused" ? &totals : fused;
+        }
+        if (!separate || !fused)
+        {
+            return;
+        }
+
+        const double separateNs = (separate->updateNs + separate->vertexNs) / static_cast<double>(separate->integrated);
+        const double fusedNs = (fused->updateNs + fused->vertexNs) / static_cast<double>(fused->integrated);
+        const double savedBytes = static_cast<double>(sizeof(sf::Vector2f)) * 1000000.0;
+        std::printf("fused vertex build at 1M: update + vertex %.3f -> %.3f ns/p, %.1f MB less read per frame "
+                    "(%.2f GB/s at 144 fps)\n",
+                    separateNs, fusedNs, savedBytes / 1e6, savedBytes * 144.0 / 1e9);
+    }
+
+    // Time Noise::Evaluate on 1M positions spread over the screen, per octave count, at each SIMD level
+    void PrintNoiseTiming()
+    {
+        constexpr size_t count = 1000000;
+        constexpr int repeats = 10;
+        std::vector<sf::Vector2f> positions(count);
+        for (auto &position : positions)
+        {
+            position = {Randomizer::RandomFloat(0.f, SCREEN_WIDTH), Randomizer::RandomFloat(0.f, SCREEN_HEIGHT)};
+        }
+        std::vector<float> values(count);
+        const Noise noise(DEFAULT_SEED);
+
+        const auto supported = static_cast<int>(SimdKernels::GetSupportedLevel());
+        for (auto level = static_cast<int>(SimdLevel::Scalar); level <= supported; ++level)
+        {
+            SimdKernels::SetLevel(static_cast<SimdLevel>(level));
+            for (const int octaves : {1, 3})
+            {
+                const NoiseSettings settings{.01f, octaves, 2.f, .5f};
+                const auto start = Clock::now();
+                for (int repeat = 0; repeat < repeats; ++repeat)
+                {
+                    noise.Evaluate(positions.data(), values.data(), count, static_cast<float>(repeat) * .1f, settings);
+                }
+                const double ns = ElapsedNs(start);
+                std::printf("noise %-6s %d octave(s): %7.3f ns/p, %6.2f ms per 1M particles\n",
+                            SimdKernels::GetLevelName(static_cast<SimdLevel>(level)), octaves,
+                            PerParticle(ns, count * repeats), ns / repeats / 1e6);
+            }
+        }
+
+        SimdKernels::SetLevel(SimdKernels::GetSupportedLevel());
+    }
+
+    // Time one ApplyAffectors pass over 1M particles, per frame
+    template <class... Affectors>
+    void TimeAffectors(const char *name, const unsigned threads, Affectors... affectors)
+    {
+        constexpr unsigned count = 1000000;
+        constexpr int frames = 20;
+        ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+        system.Initialize(count);
+        system.SetThreadCount(threads);
+        FillSteadyState(system, count);
+        system.SetAffectors(std::move(affectors)...);
+
+        const auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            system.ApplyAffectors(TIMESTEP);
+        }
+        const double ns = ElapsedNs(start);
+        std::printf("affector %-11s %7.3f ns/p, %6.2f ms per 1M particles\n", name,
+                    PerParticle(ns, static_cast<unsigned long long>(count) * frames), ns / frames / 1e6);
+    }
+
+    void PrintAffectorTiming(const unsigned threads)
+    {
+        const sf::Vector2f center{SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f};
+        TimeAffectors("gravity", threads, Gravity{});
+        TimeAffectors("wind", threads, Wind{{50.f, 0.f}, 1.f, {0.f, 0.f}, {SCREEN_WIDTH / 2.f, SCREEN_HEIGHT}});
+        TimeAffectors("drag", threads, Drag{});
+        TimeAffectors("attractor", threads, Attractor{center});
+        TimeAffectors("vortex", threads, Vortex{center});
+        TimeAffectors("turbulence", threads, Turbulence{});
+        TimeAffectors("all", threads, Gravity{}, Wind{}, Drag{}, Attractor{center}, Vortex{center}, Turbulence{});
+    }
+
+    // Build the spatial grid over 1M particles and run radius queries, the brute force counts check the results
+    void PrintGridTiming()
+    {
+        constexpr unsigned count = 1000000;
+        constexpr int builds = 20;
+        constexpr int queries = 1000;
+        constexpr float radius = 50.f;
+        ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+        system.Initialize(count);
+        FillSteadyState(system, count);
+        system.SetSpatialGrid(true);
+        const sf::Vector2f *positions = system.GetParticles().positions.data();
+
+        auto start = Clock::now();
+        for (int build = 0; build < builds; ++build)
+        {
+            system.BuildSpatialGrid();
+        }
+        const double buildNs = ElapsedNs(start);
+
+        std::vector<sf::Vector2f> centers(queries);
+        for (auto &center : centers)
+        {
+            center = Randomizer::RandomVector(0.f, SCREEN_WIDTH, 0.f, SCREEN_HEIGHT);
+        }
+
+        const SpatialGrid &grid = *system.GetSpatialGrid();
+        unsigned long long found = 0;
+        start = Clock::now();
+        for (const auto &center : centers)
+        {
+            grid.QueryRadius(positions, center, radius, [&](std::uint32_t) { ++found; });
+        }
+        const double queryNs = ElapsedNs(start);
+
+        // Brute force on the first queries only, it's a million particles per query
+        constexpr int checked = 20;
+        unsigned long long expected = 0;
+        unsigned long long foundChecked = 0;
+        start = Clock::now();
+        for (int query = 0; query < checked; ++query)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const sf::Vector2f d = positions[i] - centers[query];
+                expected += d.x * d.x + d.y * d.y <= radius * radius;
+            }
+        }
+        const double bruteNs = ElapsedNs(start);
+        for (int query = 0; query < checked; ++query)
+        {
+            grid.QueryRadius(positions, centers[query], radius, [&](std::uint32_t) { ++foundChecked; });
+        }
+
+        std::printf("grid build %.3f ns/p, %.2f ms per 1M particles; radius %.0f query %.2f us (%.0f particles), "
+                    "brute force %.2f us, results %s\n",
+                    PerParticle(buildNs, static_cast<unsigned long long>(count) * builds), buildNs / builds / 1e6,
+                    radius, queryNs / queries / 1e3, static_cast<double>(found) / queries, bruteNs / checked / 1e3,
+                    foundChecked == expected ? "ok" : "MISMATCH");
+    }
+
+    bool IsSelected(const char *name, const std::vector<std::string> &filters)
+    {
+        if (filters.empty())
+        {
+            return true;
+        }
+
+        for (const auto &filter : filters)
+        {
+            if (std::string(name).find(filter) != std::string::npos)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned seed = DEFAULT_SEED;
+    unsigned threads = 1;
+    std::vector<std::string> filters;
+    std::vector<std::string> replays;
+    std::vector<std::string> snapshots;
+    std::vector<std::pair<std::string, StageTotals>> results;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+            continue;
+        }
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            continue;
+        }
+        if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replays.emplace_back(argv[++i]);
+            continue;
+        }
+        if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+        {
+            snapshots.emplace_back(argv[++i]);
+            continue;
+        }
+        filters.emplace_back(argv[i]);
+    }
+
+    Randomizer::Seed(seed);
+    if (!CheckSimdKernels() || !CheckEffectReplay())
+    {
+        return 1;
+    }
+
+    // Only the recordings when some are given
+    if (!replays.empty())
+    {
+        bool identical = true;
+        for (const auto &path : replays)
+        {
+            identical = RunReplay(path, threads) && identical;
+        }
+        return identical ? 0 : 1;
+    }
+
+    // Same for the saved states
+    if (!snapshots.empty())
+    {
+        bool loaded = true;
+        for (const auto &path : snapshots)
+        {
+            loaded = RunSnapshot(path, threads) && loaded;
+        }
+        return loaded ? 0 : 1;
+    }
+
+    std::printf("seed %u, timestep %.6fs, threads %u, simd %s\n", seed, TIMESTEP.asSeconds(), threads,
+                SimdKernels::GetLevelName(SimdKernels::GetLevel()));
+    PrintHeader();
+
+    for (const auto &scenario : SCENARIOS)
+    {
+        if (!IsSelected(scenario.name, filters))
+        {
+            continue;
+        }
+
+        const StageTotals totals = RunScenario(scenario, seed, threads);
+        results.emplace_back(scenario.name, totals);
+        PrintTotals(scenario.name, scenario.frames, totals);
+    }
+
+    PrintFusedComparison(results);
+
+    if (IsSelected("noise", filters))
+    {
+        PrintNoiseTiming();
+    }
+
+    if (IsSelected("affector", filters))
+    {
+        PrintAffectorTiming(threads);
+    }
+
+    if (IsSelected("grid", filters))
+    {
+        PrintGridTiming();
+    }
+
+    if (IsSelected("snapshot", filters))
+    {
+        PrintSnapshotTiming();
+    }
+
+    if (IsSelected("effect", filters))
+    {
+        PrintEffectTiming();
+    }
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef AFFECTORS_H
+#define AFFECTORS_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include "Noise.h"
+
+// What every affector gets for a frame
+struct AffectorContext
+{
+    // Duration of the frame, in seconds
+    float elapsed = 0.f;
+    // Simulated time since the system started, in seconds (animates the time-varying fields)
+    float time = 0.f;
+};
+
+/*
+ * Affectors: forces applied to the velocities of a range of particles before they are integrated. Each one is a
+ * plain struct with an inline Apply() over the raw arrays, so AffectorList can inline them into its loops.
+ */
+
+// Constant acceleration
+struct Gravity
+{
+    sf::Vector2f acceleration{0.f, 98.f};
+
+    void Apply(const sf::Vector2f *, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const
+    {
+        const sf::Vector2f delta = acceleration * context.elapsed;
+        for (size_t i = 0; i < count; ++i)
+        {
+            velocities[i] += delta;
+        }
+    }
+};
+
+// Pulls the velocities of the particles inside a rectangle toward the wind velocity, strength per second
+struct Wind
+{
+    sf::Vector2f velocity{50.f, 0.f};
+    float strength = 1.f;
+    // Zone covered by the wind, top left corner and size
+    sf::Vector2f zonePosition{0.f, 0.f};
+    sf::Vector2f zoneSize{1e9f, 1e9f};
+
+    void Apply(const sf::Vector2f *positions, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const
+    {
+        const float factor = std::min(strength * context.elapsed, 1.f);
+        const sf::Vector2f zoneEnd = zonePosition + zoneSize;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const sf::Vector2f p = positions[i];
+            const bool inside = (p.x >= zonePosition.x) & (p.x < zoneEnd.x) & (p.y >= zonePosition.y) &
+                                (p.y < zoneEnd.y);
+            // Branchless: a particle outside the zone gets a zero factor
+            velocities[i] += (velocity - velocities[i]) * (factor * static_cast<float>(inside));
+        }
+    }
+};
+
+// Linear drag, the velocities lose coefficient times themselves per second
+struct Drag
+{
+    float coefficient = .5f;
+
+    void Apply(const sf::Vector2f *, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const
+    {
+        const float factor = std::max(1.f - coefficient * context.elapsed, 0.f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            velocities[i] *= factor;
+        }
+    }
+};
+
+// Inverse square pull toward a point, a negative strength repels. The softening radius caps the acceleration close
+// to the point instead of letting it go to infinity.
+struct Attractor
+{
+    sf::Vector2f position;
+    float strength = 1e6f;
+    float softening = 10.f;
+
+    void Apply(const sf::Vector2f *positions, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const
+    {
+        const float scale = strength * context.elapsed;
+        const float softening2 = softening * softening;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const sf::Vector2f d = position - positions[i];
+            const float distance2 = d.x * d.x + d.y * d.y + softening2;
+            // d / |d| / |d|^2 = d / |d|^3
+            velocities[i] += d * (scale / (distance2 * std::sqrt(distance2)));
+        }
+    }
+};
+
+// Spins the particles around a point, the tangential acceleration fades linearly to 0 at the radius
+struct Vortex
+{
+    sf::Vector2f position;
+    float strength = 500.f;
+    float radius = 200.f;
+
+    void Apply(const sf::Vector2f *positions, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const
+    {
+        const float scale = strength * context.elapsed;
+        const float inverseRadius = 1.f / radius;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const sf::Vector2f d = positions[i] - position;
+            const float distance = std::sqrt(d.x * d.x + d.y * d.y) + 1e-6f;
+            const float falloff = std::max(1.f - distance * inverseRadius, 0.f);
+            // Perpendicular unit vector (counterclockwise on screen, y pointing down)
+            velocities[i] += sf::Vector2f{-d.y, d.x} * (scale * falloff / distance);
+        }
+    }
+};
+
+// Noise driven acceleration: two fractal noise channels, animated over time, give the x and y components
+struct Turbulence
+{
+    // Particles are processed in blocks of this size, the noise values of a block live on the stack
+    static constexpr size_t BLOCK_SIZE = 256;
+    // Distance between the two channels along the time axis, far enough for them to be unrelated
+    static constexpr float CHANNEL_OFFSET = 123.45f;
+
+    Noise noise{0};
+    NoiseSettings settings{.005f, 1, 2.f, .5f};
+    float strength = 200.f;
+    // How fast the field changes, in noise units per second
+    float speed = .5f;
+
+    void Apply(const sf::Vector2f *positions, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const
+    {
+        const float scale = strength * context.elapsed;
+        const float z = context.time * speed;
+        float x[BLOCK_SIZE];
+        float y[BLOCK_SIZE];
+        for (size_t block = 0; block < count; block += BLOCK_SIZE)
+        {
+            const size_t n = std::min(BLOCK_SIZE, count - block);
+            noise.Evaluate(positions + block, x, n, z, settings);
+            noise.Evaluate(positions + block, y, n, z + CHANNEL_OFFSET, settings);
+            for (size_t i = 0; i < n; ++i)
+            {
+                velocities[block + i] += sf::Vector2f{x[i], y[i]} * scale;
+            }
+        }
+    }
+};
+
+/**
+ * A list of affectors applied in order by ParticleSystem::ApplyAffectors. The system only knows this interface,
+ * called once per chunk of particles: the per particle loops live in AffectorList, where the affector types are
+ * known at compile time (no virtual call per particle or per affector).
+ */
+class AffectorStage
+{
+public:
+    virtual ~AffectorStage() = default;
+
+    virtual void Apply(const sf::Vector2f *positions, sf::Vector2f *velocities, size_t count,
+                       const AffectorContext &context) const = 0;
+};
+
+/**
+ * AffectorStage over a fixed set of affector types. The particles go through all the affectors block by block, so
+ * the velocities of a block stay in the cache from the first affector to the last.
+ *
+ * ```
+ * auto &affectors = particleSystem.SetAffectors(Gravity{}, Drag{.2f}, Attractor{center});
+ * affectors.Get<Attractor>().position = mousePosition;
+ * ```
+ */
+template <class... Affectors>
+class AffectorList final : public AffectorStage
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 1024;
+
+    explicit AffectorList(Affectors... affectors) : _affectors(std::move(affectors)...) {}
+
+    // Access an affector to change its parameters between frames
+    template <class Affector>
+    Affector &Get()
+    {
+        return std::get<Affector>(_affectors);
+    }
+
+    void Apply(const sf::Vector2f *positions, sf::Vector2f *velocities, const size_t count,
+               const AffectorContext &context) const override
+    {
+        for (size_t block = 0; block < count; block += BLOCK_SIZE)
+        {
+            const size_t n = std::min(BLOCK_SIZE, count - block);
+            std::apply([&](const auto &...affector)
+                       { (affector.Apply(positions + block, velocities + block, n, context), ...); },
+                       _affectors);
+        }
+    }
+
+private:
+    std::tuple<Affectors...> _affectors;
+};
+
+#endif
@@ -0,0 +1,234 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "CollisionSurfaces.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Distance kept between a bounced particle and the surface, so the next frame starts on the right side
+    constexpr float SKIN = .01f;
+
+    float Cross(const sf::Vector2f a, const sf::Vector2f b) { return a.x * b.y - a.y * b.x; }
+    float Dot(const sf::Vector2f a, const sf::Vector2f b) { return a.x * b.x + a.y * b.y; }
+
+    // Whether the segment a + edge * u, u in [0, 1], crosses the rectangle [min, max] (Liang-Barsky clipping)
+    bool SegmentCrossesRect(const sf::Vector2f a, const sf::Vector2f edge, const sf::Vector2f min,
+                            const sf::Vector2f max)
+    {
+        float enter = 0.f;
+        float exit = 1.f;
+        const float p[4] = {-edge.x, edge.x, -edge.y, edge.y};
+        const float q[4] = {a.x - min.x, max.x - a.x, a.y - min.y, max.y - a.y};
+        for (int side = 0; side < 4; ++side)
+        {
+            if (p[side] == 0.f)
+            {
+                // Parallel to this side, outside of it means no crossing at all
+                if (q[side] < 0.f)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            const float r = q[side] / p[side];
+            if (p[side] < 0.f)
+            {
+                enter = std::max(enter, r);
+            }
+            else
+            {
+                exit = std::min(exit, r);
+            }
+        }
+        return enter <= exit;
+    }
+} // namespace
+
+CollisionSurfaces::CollisionSurfaces(const float width, const float height, const float cellSize, const float margin)
+    : _cellSize(cellSize)
+    , _inverseCellSize(1.f / cellSize)
+    , _margin(margin)
+    , _columns(std::max(1u, static_cast<unsigned>(std::ceil(width / cellSize))))
+    , _rows(std::max(1u, static_cast<unsigned>(std::ceil(height / cellSize))))
+    , _cellStart(static_cast<size_t>(_columns) * _rows + 1, 0)
+{
+}
+
+void CollisionSurfaces::AddSegment(const sf::Vector2f a, const sf::Vector2f b, const SurfaceMaterial &material)
+{
+    const sf::Vector2f edge = b - a;
+    const float length = std::sqrt(Dot(edge, edge));
+    if (length == 0.f)
+    {
+        return;
+    }
+
+    _segments.push_back({a, edge, sf::Vector2f{-edge.y, edge.x} / length, material});
+    _dirty = true;
+}
+
+void CollisionSurfaces::AddBox(const sf::Vector2f position, const sf::Vector2f size, const SurfaceMaterial &material)
+{
+    const sf::Vector2f topRight = position + sf::Vector2f{size.x, 0.f};
+    const sf::Vector2f bottomRight = position + size;
+    const sf::Vector2f bottomLeft = position + sf::Vector2f{0.f, size.y};
+    AddSegment(position, topRight, material);
+    AddSegment(topRight, bottomRight, material);
+    AddSegment(bottomRight, bottomLeft, material);
+    AddSegment(bottomLeft, position, material);
+}
+
+void CollisionSurfaces::Clear()
+{
+    _segments.clear();
+    _dirty = true;
+}
+
+unsigned CollisionSurfaces::GetCell(const sf::Vector2f position) const
+{
+    // Clamp in float first, the conversion of an out of range float is undefined
+    const auto x = static_cast<unsigned>(
+        std::clamp(position.x * _inverseCellSize, 0.f, static_cast<float>(_columns - 1)));
+    const auto y = static_cast<unsigned>(std::clamp(position.y * _inverseCellSize, 0.f, static_cast<float>(_rows - 1)));
+    return y * _columns + x;
+}
+
+void CollisionSurfaces::UpdateBroadphase()
+{
+    if (!_dirty)
+    {
+        return;
+    }
+    _dirty = false;
+
+    // Cells covered by the bounding box of each segment, grown by the margin
+    const auto forEachCell = [&](const Segment &segment, auto &&function)
+    {
+        const sf::Vector2f b = segment.a + segment.edge;
+        const sf::Vector2f margin{_margin, _margin};
+        const unsigned first = GetCell(sf::Vector2f{std::min(segment.a.x, b.x), std::min(segment.a.y, b.y)} - margin);
+        const unsigned last = GetCell(sf::Vector2f{std::max(segment.a.x, b.x), std::max(segment.a.y, b.y)} + margin);
+        for (unsigned y = first / _columns; y <= last / _columns; ++y)
+        {
+            for (unsigned x = first % _columns; x <= last % _columns; ++x)
+            {
+                // The bounding box of a diagonal segment covers many cells the segment doesn't cross
+                const sf::Vector2f cellMin = sf::Vector2f{static_cast<float>(x), static_cast<float>(y)} * _cellSize;
+                if (SegmentCrossesRect(segment.a, segment.edge, cellMin - margin,
+                                       cellMin + sf::Vector2f{_cellSize, _cellSize} + margin))
+                {
+                    function(y * _columns + x);
+                }
+            }
+        }
+    };
+
+    // Counting sort of the (cell, segment) pairs, like SpatialGrid
+    std::fill(_cellStart.begin(), _cellStart.end(), 0);
+    for (const Segment &segment : _segments)
+    {
+        forEachCell(segment, [&](const unsigned cell) { ++_cellStart[cell + 1]; });
+    }
+    for (size_t cell = 1; cell < _cellStart.size(); ++cell)
+    {
+        _cellStart[cell] += _cellStart[cell - 1];
+    }
+
+    _cellSegments.resize(_cellStart.back());
+    std::vector<std::uint32_t> insert(_cellStart.begin(), _cellStart.end() - 1);
+    for (size_t index = 0; index < _segments.size(); ++index)
+    {
+        forEachCell(_segments[index],
+                    [&](const unsigned cell) { _cellSegments[insert[cell]++] = static_cast<std::uint32_t>(index); });
+    }
+}
+
+size_t CollisionSurfaces::Collide(sf::Vector2f *positions, sf::Vector2f *velocities, float *timeRemainder,
+                                  const size_t count, const float elapsed, size_t &kills) const
+{
+    if (_segments.empty())
+    {
+        return 0;
+    }
+
+    const Segment *segments = _segments.data();
+    const std::uint32_t *cellStart = _cellStart.data();
+    const std::uint32_t *cellSegments = _cellSegments.data();
+    size_t hits = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const unsigned cell = GetCell(positions[i]);
+        const std::uint32_t begin = cellStart[cell];
+        const std::uint32_t end = cellStart[cell + 1];
+        if (begin == end)
+        {
+            continue;
+        }
+
+        // Earliest crossing of the path p + d * t, t in [0, 1], with a segment a + edge * u, u in [0, 1]. The
+        // fractions t = tn / denominator and u = un / denominator are compared without dividing.
+        const sf::Vector2f p = positions[i];
+        const sf::Vector2f v = velocities[i];
+        const sf::Vector2f d = v * elapsed;
+        float hitTime = 2.f;
+        const Segment *hit = nullptr;
+        for (std::uint32_t k = begin; k < end; ++k)
+        {
+            const Segment &segment = segments[cellSegments[k]];
+            const sf::Vector2f ap = segment.a - p;
+            float denominator = Cross(d, segment.edge);
+            float tn = Cross(ap, segment.edge);
+            float un = Cross(ap, d);
+            if (denominator < 0.f)
+            {
+                denominator = -denominator;
+                tn = -tn;
+                un = -un;
+            }
+
+            // Parallel paths have a zero denominator and never pass
+            if (tn >= 0.f && tn <= denominator && un >= 0.f && un <= denominator && denominator > 0.f)
+            {
+                const float t = tn / denominator;
+                if (t < hitTime)
+                {
+                    hitTime = t;
+                    hit = &segment;
+                }
+            }
+        }
+
+        if (!hit)
+        {
+            continue;
+        }
+        ++hits;
+
+        const sf::Vector2f contact = p + d * hitTime;
+        if (hit->material.response == CollisionResponse::Kill)
+        {
+            // Stop on the surface, the kill pass removes it next frame
+            positions[i] = contact;
+            velocities[i] = {0.f, 0.f};
+            timeRemainder[i] = 0.f;
+            ++kills;
+            continue;
+        }
+
+        // Normal facing the side the particle comes from
+        const sf::Vector2f normal = Dot(d, hit->normal) > 0.f ? -hit->normal : hit->normal;
+        const sf::Vector2f normalVelocity = normal * Dot(v, normal);
+        const sf::Vector2f tangentVelocity = v - normalVelocity;
+        const sf::Vector2f bounced =
+            tangentVelocity * (1.f - hit->material.friction) - normalVelocity * hit->material.restitution;
+
+        // The integration adds bounced * elapsed, landing the particle just off the surface
+        velocities[i] = bounced;
+        positions[i] = contact + normal * SKIN - bounced * elapsed;
+    }
+
+    return hits;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef COLLISIONSURFACES_H
+#define COLLISIONSURFACES_H
+
+#include <SFML/System/Vector2.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What happens to a particle that hits a surface
+enum class CollisionResponse
+{
+    // Reflect the velocity, scaled by the restitution along the normal and by 1 - friction along the surface
+    Bounce,
+    // Expire the particle, removed by the next kill pass
+    Kill
+};
+
+struct SurfaceMaterial
+{
+    CollisionResponse response = CollisionResponse::Bounce;
+    // Part of the normal speed kept after the bounce, 1 is perfectly elastic
+    float restitution = .5f;
+    // Part of the tangential speed lost in the bounce
+    float friction = .1f;
+};
+
+/**
+ * Static segments and boxes the particles collide with. A box is stored as its 4 edges.
+ *
+ * The broadphase is a uniform grid over the screen listing, for each cell, the segments crossing the cell grown by a
+ * margin. A particle then only tests the segments of the cell it starts the frame in, and most particles land in empty
+ * cells and test nothing: the cost follows the number of particles, not particles x surfaces. The margin makes the
+ * test exact for the particles moving less than margin per frame (16 px is 2300 px/s at 144 fps).
+ *
+ * The test is predictive: it runs before the integration, on the path position -> position + velocity * elapsed.
+ * On a hit the velocity is reflected and the position moved so that the integration lands the particle just off the
+ * surface, on the side it came from.
+ */
+class CollisionSurfaces
+{
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 32.f;
+    static constexpr float DEFAULT_MARGIN = 16.f;
+
+    CollisionSurfaces(float width, float height, float cellSize = DEFAULT_CELL_SIZE, float margin = DEFAULT_MARGIN);
+
+    void AddSegment(sf::Vector2f a, sf::Vector2f b, const SurfaceMaterial &material = {});
+    // Axis aligned box from its top left corner and its size
+    void AddBox(sf::Vector2f position, sf::Vector2f size, const SurfaceMaterial &material = {});
+    void Clear();
+    bool IsEmpty() const { return _segments.empty(); }
+    size_t GetNumberOfSegments() const { return _segments.size(); }
+
+    // Rebuild the broadphase after the surfaces changed, must be called before Collide (ParticleSystem does)
+    void UpdateBroadphase();
+
+    // Collide count particles moving for elapsed seconds, returns the number of hits and adds the particles killed
+    // (CollisionResponse::Kill) to kills. Thread-safe on disjoint ranges once the broadphase is up to date.
+    size_t Collide(sf::Vector2f *positions, sf::Vector2f *velocities, float *timeRemainder, size_t count,
+                   float elapsed, size_t &kills) const;
+
+private:
+    struct Segment
+    {
+        sf::Vector2f a;
+        sf::Vector2f edge;
+        // Unit normal, the side is chosen per particle
+        sf::Vector2f normal;
+        SurfaceMaterial material;
+    };
+
+    std::vector<Segment> _segments;
+
+    float _cellSize;
+    float _inverseCellSize;
+    float _margin;
+    unsigned _columns;
+    unsigned _rows;
+    bool _dirty = false;
+    // For each cell, the range [_cellStart[cell], _cellStart[cell + 1]) of _cellSegments
+    std::vector<std::uint32_t> _cellStart;
+    std::vector<std::uint32_t> _cellSegments;
+
+    unsigned GetCell(sf::Vector2f position) const;
+};
+
+#endif
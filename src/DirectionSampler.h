@@ -0,0 +1,91 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef DIRECTIONSAMPLER_H
+#define DIRECTIONSAMPLER_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * Draws unit vectors inside a cone (or the full ring for a zero direction) without any trigonometry per sample.
+ *
+ * The base angle and the arc are computed once in the constructor; each sample then maps a uniform value in [0, 1)
+ * onto the arc and linearly interpolates a cos/sin table of TABLE_SIZE steps over the full circle. The error of the
+ * interpolation is at most step^2 / 8 on each component (step = 2 pi / TABLE_SIZE), see MAX_ERROR; the vectors are
+ * thus unit length within the same bound, which is invisible at particle scale.
+ *
+ * ```
+ * const DirectionSampler sampler(direction, angle);
+ * for (...) velocity = sampler.Sample(uniform01) * speed;
+ * ```
+ */
+class DirectionSampler
+{
+public:
+    static constexpr std::size_t TABLE_SIZE = 1024;
+
+    // step^2 / 8 = 4.7e-6 plus the float rounding of the table and the interpolation
+    static constexpr float MAX_ERROR = 1e-5f;
+
+    DirectionSampler(const sf::Vector2f &direction, const float angle) : _table(GetTable())
+    {
+        constexpr float stepsPerRadian = TABLE_SIZE / static_cast<float>(2 * M_PI);
+
+        // Zero vector: any direction
+        if (direction.x == 0 && direction.y == 0)
+        {
+            _start = 0.f;
+            _arc = static_cast<float>(TABLE_SIZE);
+            return;
+        }
+
+        // Work in table steps, with the start wrapped into [0, TABLE_SIZE) so the phase is never negative
+        const float arc = std::clamp(angle, 0.f, static_cast<float>(2 * M_PI));
+        const float start = (std::atan2(direction.y, direction.x) - arc / 2) * stepsPerRadian;
+        _start = start - std::floor(start / TABLE_SIZE) * TABLE_SIZE;
+        _arc = arc * stepsPerRadian;
+    }
+
+    // Unit vector for a uniform value in [0, 1)
+    sf::Vector2f Sample(const float uniform) const
+    {
+        // phase < 2 * TABLE_SIZE, the mask wraps the second turn back onto the table
+        const float phase = _start + uniform * _arc;
+        const auto step = static_cast<std::size_t>(phase);
+        const float fraction = phase - static_cast<float>(step);
+        const std::size_t index = step & (TABLE_SIZE - 1);
+
+        const sf::Vector2f &a = _table[index];
+        const sf::Vector2f &b = _table[index + 1];
+        return {a.x + (b.x - a.x) * fraction, a.y + (b.y - a.y) * fraction};
+    }
+
+private:
+    // One extra entry so index + 1 never wraps
+    using Table = std::array<sf::Vector2f, TABLE_SIZE + 1>;
+
+    const Table &_table;
+    float _start = 0.f;
+    float _arc = 0.f;
+
+    static const Table &GetTable()
+    {
+        static const Table table = []
+        {
+            Table values{};
+            for (std::size_t i = 0; i <= TABLE_SIZE; ++i)
+            {
+                const double angle = 2 * M_PI * static_cast<double>(i) / TABLE_SIZE;
+                values[i] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+            }
+            return values;
+        }();
+        return table;
+    }
+};
+
+#endif
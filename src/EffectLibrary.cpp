@@ -0,0 +1,296 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "EffectLibrary.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "ParticleSystem.h"
+
+namespace
+{
+    // What the values of a key must be, checked before calling the setter
+    enum class Domain
+    {
+        Any,
+        Positive,
+        NotNegative,
+        // min max, min <= max
+        Range,
+        // min max, 0 <= min <= max
+        NotNegativeRange
+    };
+
+    // A key of the file and the ParticleEmitter setter it calls with its values
+    struct Setter
+    {
+        const char *key;
+        size_t floats;
+        size_t colors;
+        void (*apply)(ParticleEmitter &emitter, const float *values, const ParticleColor *colors);
+        Domain domain = Domain::Any;
+    };
+
+    const Setter SETTERS[] = {
+            {"position", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetPosition({v[0], v[1]}); }},
+            {"direction", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetDirection({v[0], v[1]}); }},
+            {"angle", 1, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetAngle(v[0]); }},
+            {"duration", 1, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetDuration(v[0]); }, Domain::NotNegative},
+            {"emissionRate", 1, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetEmissionRate(v[0]); }, Domain::Positive},
+            {"particlesPerEmission", 1, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetParticlesPerEmission(static_cast<unsigned>(std::max(v[0], 0.f))); }},
+            {"atlasFrame", 1, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetAtlasFrame(static_cast<std::uint16_t>(std::clamp(v[0], 0.f, 65535.f))); }},
+            {"color", 0, 1,
+             [](ParticleEmitter &e, const float *, const ParticleColor *c)
+             { e.SetColor(c[0]); }},
+            {"colorOverLifetime", 0, 2,
+             [](ParticleEmitter &e, const float *, const ParticleColor *c)
+             { e.SetColorOverLifetime(c[0], c[1]); }},
+            {"velocity", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetVelocity(v[0], v[1]); }, Domain::Range},
+            {"lifetime", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetLifetime(v[0], v[1]); }, Domain::NotNegativeRange},
+            {"alphaOverLifetime", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetAlphaOverLifetime(v[0], v[1]); }},
+            {"scaleOverLifetime", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetScaleOverLifetime(v[0], v[1]); }},
+            {"size", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetSize(v[0], v[1]); }, Domain::NotNegativeRange},
+            {"rotation", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetRotation(v[0], v[1]); }, Domain::Range},
+            {"spin", 2, 0,
+             [](ParticleEmitter &e, const float *v, const ParticleColor *)
+             { e.SetSpin(v[0], v[1]); }, Domain::Range},
+    };
+
+    std::string Trim(const std::string &text)
+    {
+        const auto isSpace = [](const unsigned char c) { return std::isspace(c) != 0; };
+        const auto begin = std::find_if_not(text.begin(), text.end(), isSpace);
+        const auto end = std::find_if_not(text.rbegin(), text.rend(), isSpace).base();
+        return begin < end ? std::string(begin, end) : std::string();
+    }
+
+    // The line without its comment: a # at the start of the line or followed by a space (the colors start with #)
+    std::string StripComment(const std::string &line)
+    {
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            const bool lineStart = line.find_first_not_of(" \t") == i;
+            const bool spaced = i + 1 == line.size() || std::isspace(static_cast<unsigned char>(line[i + 1]));
+            if (line[i] == '#' && (lineStart || spaced))
+            {
+                return line.substr(0, i);
+            }
+        }
+        return line;
+    }
+
+    // "#RRGGBB" or "#RRGGBBAA"
+    bool ParseColor(const std::string &token, ParticleColor &color)
+    {
+        if (token.size() != 7 && token.size() != 9)
+        {
+            return false;
+        }
+        if (token[0] != '#' || !std::all_of(token.begin() + 1, token.end(),
+                                            [](const unsigned char c) { return std::isxdigit(c) != 0; }))
+        {
+            return false;
+        }
+
+        const auto channel = [&token](const size_t at)
+        { return static_cast<std::uint8_t>(std::stoul(token.substr(at, 2), nullptr, 16)); };
+        color = ParticleColor(channel(1), channel(3), channel(5), token.size() == 9 ? channel(7) : 255);
+        return true;
+    }
+
+    // Exactly the values the setter takes, floats or colors
+    bool ParseValues(const std::string &text, const Setter &setter, float *values, ParticleColor *colors)
+    {
+        std::istringstream stream(text);
+        for (size_t i = 0; i < setter.floats; ++i)
+        {
+            if (!(stream >> values[i]))
+            {
+                return false;
+            }
+        }
+        std::string token;
+        for (size_t i = 0; i < setter.colors; ++i)
+        {
+            if (!(stream >> token) || !ParseColor(token, colors[i]))
+            {
+                return false;
+            }
+        }
+        return !(stream >> token);
+    }
+
+    // nullptr if the values are in the domain of the setter, the reason otherwise (the comparisons also reject NaN)
+    const char *CheckValues(const Setter &setter, const float *values)
+    {
+        switch (setter.domain)
+        {
+            case Domain::Any:
+                break;
+            case Domain::Positive:
+                return values[0] > 0.f ? nullptr : " must be positive";
+            case Domain::NotNegative:
+                return values[0] >= 0.f ? nullptr : " can't be negative";
+            case Domain::NotNegativeRange:
+                if (!(values[0] >= 0.f))
+                {
+                    return " can't be negative";
+                }
+                [[fallthrough]];
+            case Domain::Range:
+                return values[0] <= values[1] ? nullptr : " min is above max";
+        }
+        return nullptr;
+    }
+} // namespace
+
+bool EffectLibrary::Parse(std::istream &stream, std::map<std::string, Recipe> &recipes, std::string &error)
+{
+    Recipe *recipe = nullptr;
+    std::string line;
+    for (size_t number = 1; std::getline(stream, line); ++number)
+    {
+        line = Trim(StripComment(line));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        // [effect.emitter] starts a new emitter of the effect
+        if (line.front() == '[')
+        {
+            const std::string name = Trim(line.substr(1, line.size() - 1 - (line.back() == ']')));
+            const std::string effect = name.substr(0, name.find('.'));
+            if (line.back() != ']' || effect.empty())
+            {
+                error = std::to_string(number) + ": expected [effect.emitter]";
+                return false;
+            }
+            recipe = &recipes[effect];
+            recipe->emplace_back(sf::Vector2f());
+            continue;
+        }
+
+        const size_t equal = line.find('=');
+        if (equal == std::string::npos)
+        {
+            error = std::to_string(number) + ": expected key = value";
+            return false;
+        }
+        if (!recipe)
+        {
+            error = std::to_string(number) + ": key outside of an [effect.emitter] section";
+            return false;
+        }
+
+        const std::string key = Trim(line.substr(0, equal));
+        const auto setter = std::find_if(std::begin(SETTERS), std::end(SETTERS),
+                                         [&key](const Setter &candidate) { return key == candidate.key; });
+        if (setter == std::end(SETTERS))
+        {
+            error = std::to_string(number) + ": unknown key " + key;
+            return false;
+        }
+
+        float values[2];
+        ParticleColor colors[2];
+        if (!ParseValues(line.substr(equal + 1), *setter, values, colors))
+        {
+            error = std::to_string(number) + ": " + key + " takes " +
+                    (setter->colors > 0 ? std::to_string(setter->colors) + " color(s)"
+                                        : std::to_string(setter->floats) + " number(s)");
+            return false;
+        }
+        if (const char *reason = CheckValues(*setter, values))
+        {
+            error = std::to_string(number) + ": " + key + reason;
+            return false;
+        }
+        setter->apply(recipe->back(), values, colors);
+    }
+    return true;
+}
+
+bool EffectLibrary::Load(const std::string &path, ParticleSystem &system)
+{
+    std::ifstream stream(path);
+    std::error_code errorCode;
+    const auto modified = std::filesystem::last_write_time(path, errorCode);
+    if (!stream || errorCode)
+    {
+        _error = path + ": can't read the file";
+        return false;
+    }
+
+    // A broken file isn't parsed again until it's written again
+    _path = path;
+    _modified = modified;
+
+    std::map<std::string, Recipe> recipes;
+    std::string error;
+    if (!Parse(stream, recipes, error))
+    {
+        _error = path + ":" + error;
+        return false;
+    }
+
+    std::map<std::string, EffectTemplate> effects;
+    for (const auto &[name, recipe] : recipes)
+    {
+        effects.emplace(name, system.CompileEffect(recipe));
+    }
+    _effects = std::move(effects);
+    _error.clear();
+    return true;
+}
+
+bool EffectLibrary::ReloadIfModified(ParticleSystem &system)
+{
+    if (_path.empty())
+    {
+        return false;
+    }
+
+    std::error_code errorCode;
+    const auto modified = std::filesystem::last_write_time(_path, errorCode);
+    if (errorCode || modified == _modified)
+    {
+        return false;
+    }
+    Load(_path, system);
+    return true;
+}
+
+const EffectTemplate *EffectLibrary::Find(const std::string &name) const
+{
+    const auto found = _effects.find(name);
+    return found != _effects.end() ? &found->second : nullptr;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef EFFECTLIBRARY_H
+#define EFFECTLIBRARY_H
+
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "EmitterPool.h"
+#include "ParticleEmitter.h"
+
+// Forward Declaration
+class ParticleSystem;
+
+/**
+ * Effects described in a text file, one section per emitter named effect.emitter, the keys being the setters of
+ * ParticleEmitter. The emitters of an effect are spawned in the order of the file, their position is relative to the
+ * spawn point. The file is parsed once and every effect compiled into an EffectTemplate, so spawning one is a copy
+ * of its rows into the emitter pool.
+ *
+ * ```
+ * # Comment, a # starting the line or followed by a space
+ * [explosion.smoke]
+ * color = #F8F8F2                  # #RRGGBB or #RRGGBBAA
+ * duration = 5
+ * velocity = 5 10                  # the setters taking a range take 2 values
+ * alphaOverLifetime = 1 0
+ * ```
+ *
+ * Keys: position, direction (2 values), angle, duration, emissionRate, particlesPerEmission, atlasFrame (1 value),
+ * color (1 color), colorOverLifetime (2 colors), velocity, lifetime, alphaOverLifetime, scaleOverLifetime, size,
+ * rotation, spin (2 values). The angles are in radians. The emissionRate must be positive, the duration, lifetime
+ * and size can't be negative, and the min of a range can't be above its max.
+ *
+ * Every Load interns the curves of its effects into the CurveLibrary of the system, which never frees them (the
+ * particles alive may still use them). Reloading an unchanged curve finds its table again, but each edited curve
+ * adds one: past 65536 tables, the new curves silently become the constant one until the system is recreated.
+ *
+ * ```
+ * EffectLibrary effects;
+ * effects.Load("assets/effects.ini", system);
+ * system.SpawnEffect(*effects.Find("explosion"), position);
+ * effects.ReloadIfModified(system);     // hot reload, once in a while
+ * ```
+ */
+class EffectLibrary
+{
+public:
+    // Recipe of one effect, the emitters as described by the file
+    using Recipe = std::vector<ParticleEmitter>;
+
+    // Parse the file and compile its effects for system, replacing the loaded ones. Returns false if the file can't
+    // be read or has an error (see GetError), the effects already loaded are then kept.
+    bool Load(const std::string &path, ParticleSystem &system);
+    // Load the file again if it was written since the last Load, returns true if it did (see GetError for the result)
+    bool ReloadIfModified(ParticleSystem &system);
+
+    // nullptr if there's no such effect. Invalidated by the next successful Load.
+    const EffectTemplate *Find(const std::string &name) const;
+    size_t GetSize() const { return _effects.size(); }
+    // "path:line: message" of the last failed Load, empty after a successful one
+    const std::string &GetError() const { return _error; }
+
+    // Append the recipes of the text to recipes, returns false with a "line: message" error on the first mistake
+    static bool Parse(std::istream &stream, std::map<std::string, Recipe> &recipes, std::string &error);
+
+private:
+    std::string _path;
+    std::filesystem::file_time_type _modified;
+    std::map<std::string, EffectTemplate> _effects;
+    std::string _error;
+};
+
+#endif
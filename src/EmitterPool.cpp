@@ -0,0 +1,291 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "EmitterPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ParticleSystem.h"
+#include "Randomizer.h"
+#include "Tracer.h"
+
+namespace
+{
+    // Uniform values in [min, max], without drawing random numbers for a constant range (the default of the quad
+    // properties, so the emitters that don't use them keep the same random sequence)
+    void FillRange(float *out, const size_t count, const float min, const float max)
+    {
+        if (min == max)
+        {
+            std::fill_n(out, count, min);
+            return;
+        }
+        Randomizer::FillFloats(out, count, min, max);
+    }
+} // namespace
+
+void EmitterPool::Reserve(const size_t count)
+{
+    _table.ForEachArray([count](auto &array) { array.reserve(count); });
+    _slots.reserve(count);
+    _freeSlots.reserve(count);
+    _emissionCounts.reserve(count);
+}
+
+EmitterHandle EmitterPool::Spawn(const ParticleEmitter &emitter, const std::uint16_t curveId,
+                                 const ParticleStorage::Color color)
+{
+    const std::uint32_t slot = AllocateSlot(static_cast<std::uint32_t>(_table.slots.size()));
+    _table.Append(emitter, curveId, color, slot);
+    return {slot, _slots[slot].generation};
+}
+
+void EmitterPool::AddToEffect(EffectTemplate &effect, const ParticleEmitter &emitter, const std::uint16_t curveId,
+                              const ParticleStorage::Color color)
+{
+    effect._table.Append(emitter, curveId, color, 0);
+    effect._emitters.push_back(emitter);
+}
+
+void EmitterPool::SpawnEffect(const EffectTemplate &effect, const sf::Vector2f &position)
+{
+    // One range copy per array, then the positions and the slots of the new rows
+    const size_t first = _table.slots.size();
+    Table::ForEachMember(
+            [this, &effect](const auto member)
+            {
+                auto &array = _table.*member;
+                const auto &rows = effect._table.*member;
+                array.insert(array.end(), rows.begin(), rows.end());
+            });
+    for (size_t i = first; i < _table.slots.size(); ++i)
+    {
+        _table.positions[i] += position;
+        _table.slots[i] = AllocateSlot(static_cast<std::uint32_t>(i));
+    }
+}
+
+std::uint32_t EmitterPool::AllocateSlot(const std::uint32_t dense)
+{
+    // Reuse a free slot if there is one
+    std::uint32_t slot;
+    if (!_freeSlots.empty())
+    {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<std::uint32_t>(_slots.size());
+        _slots.emplace_back();
+    }
+    _slots[slot].dense = dense;
+    return slot;
+}
+
+void EmitterPool::Table::Append(const ParticleEmitter &emitter, const std::uint16_t curveId,
+                                const ParticleStorage::Color color, const std::uint32_t slot)
+{
+    const auto &emitterProps = emitter.GetEmitterProperties();
+    const auto &particleProps = emitter.GetParticleProperties();
+    positions.push_back(emitterProps.position);
+    directions.push_back(emitterProps.direction);
+    angles.push_back(emitterProps.angle);
+    durations.push_back(emitterProps.duration);
+    particlesPerEmission.push_back(emitterProps.particlesPerEmission);
+    emissionRates.push_back(emitterProps.emissionRate);
+    colors.push_back(color);
+    minLifetimes.push_back(particleProps.minLifetime);
+    maxLifetimes.push_back(particleProps.maxLifetime);
+    minVelocities.push_back(particleProps.minVelocity);
+    maxVelocities.push_back(particleProps.maxVelocity);
+    curveIds.push_back(curveId);
+    minSizes.push_back(particleProps.minSize);
+    maxSizes.push_back(particleProps.maxSize);
+    minRotations.push_back(particleProps.minRotation);
+    maxRotations.push_back(particleProps.maxRotation);
+    minSpins.push_back(particleProps.minSpin);
+    maxSpins.push_back(particleProps.maxSpin);
+    frames.push_back(particleProps.frame);
+    timeElapsed.push_back(0.f);
+    emissionAccumulators.push_back(0.f);
+    slots.push_back(slot);
+}
+
+bool EmitterPool::Despawn(const EmitterHandle handle)
+{
+    if (!IsAlive(handle))
+    {
+        return false;
+    }
+
+    RemoveAt(_slots[handle.index].dense);
+    return true;
+}
+
+bool EmitterPool::IsAlive(const EmitterHandle handle) const
+{
+    // Removing an emitter bumps the generation of its slot, so a free slot never matches a handle
+    return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation;
+}
+
+size_t EmitterPool::GetSize() const { return _table.slots.size(); }
+
+bool EmitterPool::IsConsistent(const size_t curveCount) const
+{
+    const size_t count = _table.slots.size();
+    if (_slots.size() != count + _freeSlots.size() ||
+        std::any_of(_table.curveIds.begin(), _table.curveIds.end(),
+                    [curveCount](const std::uint16_t id) { return id >= curveCount; }))
+    {
+        return false;
+    }
+
+    // Every slot is used once, by the emitter it points at or by the free list
+    std::vector<bool> used(_slots.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::uint32_t slot = _table.slots[i];
+        if (slot >= _slots.size() || used[slot] || _slots[slot].dense != i)
+        {
+            return false;
+        }
+        used[slot] = true;
+    }
+    for (const std::uint32_t slot : _freeSlots)
+    {
+        if (slot >= _slots.size() || used[slot])
+        {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+void EmitterPool::RemoveAt(const size_t index)
+{
+    // Invalidate the handles of the removed emitter
+    const std::uint32_t slot = _table.slots[index];
+    ++_slots[slot].generation;
+    _freeSlots.push_back(slot);
+
+    // The last emitter takes its place
+    const std::uint32_t movedSlot = _table.slots.back();
+    _table.ForEachArray(
+            [index](auto &array)
+            {
+                array[index] = array.back();
+                array.pop_back();
+            });
+    if (index < _table.slots.size())
+    {
+        _slots[movedSlot].dense = static_cast<std::uint32_t>(index);
+    }
+}
+
+void EmitterPool::Update(const sf::Time &time, ParticleSystem &system)
+{
+    PARTICLES_TRACE_SCOPE("EmitterPool::Update");
+    const float elapsed = time.asSeconds();
+    const size_t count = _table.slots.size();
+
+    // Advance the timers and compute the number of emissions of every emitter, an emitter that reached its
+    // duration doesn't emit anymore
+    _emissionCounts.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        _table.timeElapsed[i] += elapsed;
+        const bool active = _table.timeElapsed[i] < _table.durations[i];
+
+        // Use the emissionRate to determine if particles should be emitted, a rate that isn't finite and positive
+        // never emits (its interval would turn the accumulator into NaN or a negative count)
+        const float emissionRate = _table.emissionRates[i];
+        unsigned int emissionCount = 0;
+        if (emissionRate > 0.f && std::isfinite(emissionRate))
+        {
+            const float emissionInterval = 1.0f / emissionRate;
+            float &accumulator = _table.emissionAccumulators[i];
+            accumulator = std::min(accumulator + elapsed, MAX_EMISSIONS_PER_UPDATE * emissionInterval);
+            if (accumulator >= emissionInterval)
+            {
+                emissionCount = std::min(static_cast<unsigned int>(accumulator / emissionInterval),
+                                         MAX_EMISSIONS_PER_UPDATE);
+                accumulator -= emissionCount * emissionInterval;
+            }
+        }
+
+        _emissionCounts[i] = active ? emissionCount : 0;
+    }
+
+    // Emit the Particles in the System
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (_emissionCounts[i] > 0)
+        {
+            Emit(i, _emissionCounts[i], system);
+        }
+    }
+
+    // Remove the emitters that reached their duration, backward so the swapped-in emitter was already checked
+    for (size_t i = count; i-- > 0;)
+    {
+        if (_table.timeElapsed[i] >= _table.durations[i])
+        {
+            RemoveAt(i);
+        }
+    }
+}
+
+void EmitterPool::Emit(const size_t index, const unsigned int emissionCount, ParticleSystem &system)
+{
+    // Reserve the particles of all the emissions at once, then fill each array of the batch
+    TraceScope trace("EmitterPool::Emit");
+    // Saturated instead of wrapping around, the overflow policy of the system then decides what fits
+    constexpr unsigned int maxCount = std::numeric_limits<unsigned int>::max();
+    const unsigned int perEmission = _table.particlesPerEmission[index];
+    const unsigned int count = perEmission > maxCount / emissionCount ? maxCount : emissionCount * perEmission;
+    const ParticleBatch batch = system.SpawnParticles(count);
+    trace.SetCount(batch.count);
+
+    std::fill_n(batch.positions, batch.count, _table.positions[index]);
+    std::fill_n(batch.colors, batch.count, _table.colors[index]);
+    std::fill_n(batch.curveIds, batch.count, _table.curveIds[index]);
+    std::fill_n(batch.frames, batch.count, _table.frames[index]);
+    FillRange(batch.rotations, batch.count, _table.minRotations[index], _table.maxRotations[index]);
+    FillRange(batch.spins, batch.count, _table.minSpins[index], _table.maxSpins[index]);
+
+    // Square quads
+    if (_randoms.size() < batch.count)
+    {
+        _randoms.resize(batch.count);
+    }
+    float *randoms = _randoms.data();
+    FillRange(randoms, batch.count, _table.minSizes[index], _table.maxSizes[index]);
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        batch.scales[i] = {randoms[i], randoms[i]};
+    }
+
+    // Unit directions scaled by a random speed
+    ForEachVelocityBlock<true>(
+            batch.velocities, batch.count,
+            [&](sf::Vector2f *velocities, const size_t offset, const size_t n)
+            {
+                float *speeds = randoms + offset;
+                Randomizer::FillDirections(velocities, n, _table.directions[index], _table.angles[index]);
+                Randomizer::FillFloats(speeds, n, _table.minVelocities[index], _table.maxVelocities[index]);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    velocities[i] *= speeds[i];
+                }
+            });
+
+    Randomizer::FillFloats(randoms, batch.count, _table.minLifetimes[index], _table.maxLifetimes[index]);
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        batch.lifeTimes[i] = ParticleStorage::EncodeLifeTime(randoms[i]);
+        batch.timeRemainder[i] = ParticleStorage::EncodeTimeRemainder(randoms[i], randoms[i]);
+    }
+}
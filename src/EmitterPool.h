@@ -0,0 +1,208 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef EMITTERPOOL_H
+#define EMITTERPOOL_H
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ParticleEmitter.h"
+
+// Stable reference to an emitter of an EmitterPool, stays valid (and detectably stale) when other emitters are
+// removed. The generation changes every time the slot is reused.
+struct EmitterHandle
+{
+    static constexpr std::uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    std::uint32_t index = INVALID_INDEX;
+    std::uint32_t generation = 0;
+
+    bool IsValid() const { return index != INVALID_INDEX; }
+};
+
+// Forward Declaration
+class EffectTemplate;
+class ParticleSystem;
+
+/**
+ * The emitters of a ParticleSystem, stored by value in a dense SoA table (no allocation per emitter). Removing an
+ * emitter moves the last one into its place, so it's O(1), and the handles go through a slot table so they survive
+ * the move. The update runs over the timers of all the emitters in one tight loop before emitting.
+ */
+class EmitterPool
+{
+public:
+    // Most emissions of an emitter in one update, its accumulator is clamped to them (a long frame, or a huge rate)
+    static constexpr unsigned int MAX_EMISSIONS_PER_UPDATE = 1024;
+
+    EmitterPool() = default;
+    ~EmitterPool() = default;
+
+    // Pre-allocate the table for count emitters
+    void Reserve(size_t count);
+
+    // Copy the emitter into the pool and start it, its particles get the lifetime curves curveId and the color (encoded
+    // by the palette of the particles) of the system
+    EmitterHandle Spawn(const ParticleEmitter &emitter, std::uint16_t curveId, ParticleStorage::Color color);
+    // Remove the emitter, returns false if the handle is stale
+    bool Despawn(EmitterHandle handle);
+    bool IsAlive(EmitterHandle handle) const;
+    size_t GetSize() const;
+    // True if the slots and the free slots match the table and every curve id is below curveCount, checked on the
+    // pools read from a snapshot
+    bool IsConsistent(size_t curveCount) const;
+
+    // Append the emitter to effect with the values Spawn would give it, see ParticleSystem::CompileEffect
+    static void AddToEffect(EffectTemplate &effect, const ParticleEmitter &emitter, std::uint16_t curveId,
+                            ParticleStorage::Color color);
+    // Copy every emitter of the effect into the pool at once, their positions offset by position, and start them
+    void SpawnEffect(const EffectTemplate &effect, const sf::Vector2f &position);
+
+    // Advance the emitters, spawn their particles in the system and remove the ones that reached their duration
+    void Update(const sf::Time &time, ParticleSystem &system);
+
+    // Call function on every array of the pool: the table, then the slots and the free slots (see ParticleSnapshot)
+    template <typename Function>
+    void ForEachArray(Function &&function)
+    {
+        _table.ForEachArray(function);
+        function(_slots);
+        function(_freeSlots);
+    }
+    template <typename Function>
+    void ForEachArray(Function &&function) const
+    {
+        _table.ForEachArray(function);
+        function(_slots);
+        function(_freeSlots);
+    }
+
+private:
+    friend class EffectTemplate;
+
+    // Dense SoA, index i of every array is the same emitter
+    struct Table
+    {
+        // Emitter properties
+        std::vector<sf::Vector2f> positions;
+        std::vector<sf::Vector2f> directions;
+        std::vector<float> angles;
+        std::vector<float> durations;
+        std::vector<unsigned int> particlesPerEmission;
+        std::vector<float> emissionRates;
+
+        // Particle properties
+        std::vector<ParticleStorage::Color> colors;
+        std::vector<float> minLifetimes;
+        std::vector<float> maxLifetimes;
+        std::vector<float> minVelocities;
+        std::vector<float> maxVelocities;
+        std::vector<std::uint16_t> curveIds;
+        std::vector<float> minSizes;
+        std::vector<float> maxSizes;
+        std::vector<float> minRotations;
+        std::vector<float> maxRotations;
+        std::vector<float> minSpins;
+        std::vector<float> maxSpins;
+        std::vector<std::uint16_t> frames;
+
+        // States
+        std::vector<float> timeElapsed;
+        std::vector<float> emissionAccumulators;
+        // The slot pointing at this emitter
+        std::vector<std::uint32_t> slots;
+
+        template <typename Function>
+        void ForEachArray(Function &&function)
+        {
+            ForEachMember([this, &function](const auto member) { function(this->*member); });
+        }
+        template <typename Function>
+        void ForEachArray(Function &&function) const
+        {
+            ForEachMember([this, &function](const auto member) { function(this->*member); });
+        }
+
+        // Call function with a pointer to every array member, to walk two tables together (see SpawnEffect)
+        template <typename Function>
+        static void ForEachMember(Function &&function)
+        {
+            function(&Table::positions);
+            function(&Table::directions);
+            function(&Table::angles);
+            function(&Table::durations);
+            function(&Table::particlesPerEmission);
+            function(&Table::emissionRates);
+            function(&Table::colors);
+            function(&Table::minLifetimes);
+            function(&Table::maxLifetimes);
+            function(&Table::minVelocities);
+            function(&Table::maxVelocities);
+            function(&Table::curveIds);
+            function(&Table::minSizes);
+            function(&Table::maxSizes);
+            function(&Table::minRotations);
+            function(&Table::maxRotations);
+            function(&Table::minSpins);
+            function(&Table::maxSpins);
+            function(&Table::frames);
+            function(&Table::timeElapsed);
+            function(&Table::emissionAccumulators);
+            function(&Table::slots);
+        }
+
+        // Append the emitter, not started yet
+        void Append(const ParticleEmitter &emitter, std::uint16_t curveId, ParticleStorage::Color color,
+                    std::uint32_t slot);
+    };
+
+    struct Slot
+    {
+        // Index in the table, meaningless while the slot is free
+        std::uint32_t dense = 0;
+        std::uint32_t generation = 0;
+    };
+
+    Table _table;
+    std::vector<Slot> _slots;
+    std::vector<std::uint32_t> _freeSlots;
+    // Scratch: number of emissions of every emitter during the current update
+    std::vector<unsigned int> _emissionCounts;
+    // Scratch: the random sizes, speeds and lifetimes of an Emit, in seconds whatever the storage of the particles
+    std::vector<float> _randoms;
+
+    // A free slot (or a new one) pointing at the table index dense
+    std::uint32_t AllocateSlot(std::uint32_t dense);
+    // Generate the particles of emissionCount emissions of the emitter at index
+    void Emit(size_t index, unsigned int emissionCount, ParticleSystem &system);
+    // Swap the emitter at index with the last one and pop it
+    void RemoveAt(size_t index);
+};
+
+/**
+ * A set of emitters compiled once into the rows of the emitter table: the lifetime curves already baked, the colors
+ * encoded and the positions relative to the spawn point. Spawning it (ParticleSystem::SpawnEffect) appends the rows
+ * to every array of the pool, without any allocation per emitter nor curve lookup. Immutable once compiled, and only
+ * valid for the system that compiled it (the curve ids are the ones of its library).
+ */
+class EffectTemplate
+{
+public:
+    size_t GetSize() const { return _table.slots.size(); }
+    bool IsEmpty() const { return _table.slots.empty(); }
+    // The emitters it was compiled from, positions relative to the spawn point
+    const std::vector<ParticleEmitter> &GetEmitters() const { return _emitters; }
+
+private:
+    friend class EmitterPool;
+
+    // The slots are unused, the pool gives them on spawn
+    EmitterPool::Table _table;
+    std::vector<ParticleEmitter> _emitters;
+};
+
+#endif
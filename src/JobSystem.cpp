@@ -0,0 +1,118 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Tracer.h"
+
+JobSystem::JobSystem(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _workers.reserve(threadCount - 1);
+    for (unsigned i = 1; i < threadCount; ++i)
+    {
+        _workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+
+    for (auto &worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::ParallelFor(const size_t count, const size_t minChunkSize,
+                            const std::function<void(size_t, size_t)> &function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Not worth waking up the workers for a single chunk
+    const size_t threads = _workers.size() + 1;
+    const size_t chunkSize = std::max(minChunkSize, (count + threads - 1) / threads);
+    if (_workers.empty() || chunkSize >= count)
+    {
+        function(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard lock(_mutex);
+        _function = &function;
+        _count = count;
+        _chunkSize = chunkSize;
+        _nextChunk.store(0, std::memory_order_relaxed);
+        _busyWorkers = static_cast<unsigned>(_workers.size());
+        ++_generation;
+    }
+    _wakeUp.notify_all();
+
+    RunChunks();
+
+    // Wait for the workers, they may still be running their last chunk
+    std::unique_lock lock(_mutex);
+    _done.wait(lock, [this] { return _busyWorkers == 0; });
+    _function = nullptr;
+}
+
+unsigned JobSystem::GetThreadCount() const { return static_cast<unsigned>(_workers.size() + 1); }
+
+void JobSystem::WorkerLoop(const unsigned index)
+{
+    // Named in the traces
+    Tracer::SetThreadName("worker " + std::to_string(index));
+    unsigned long long seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(_mutex);
+            _wakeUp.wait(lock, [this, seenGeneration] { return _stopping || _generation != seenGeneration; });
+            if (_stopping)
+            {
+                return;
+            }
+            seenGeneration = _generation;
+        }
+
+        RunChunks();
+
+        {
+            std::lock_guard lock(_mutex);
+            --_busyWorkers;
+        }
+        _done.notify_one();
+    }
+}
+
+void JobSystem::RunChunks()
+{
+    while (true)
+    {
+        const size_t begin = _nextChunk.fetch_add(_chunkSize, std::memory_order_relaxed);
+        if (begin >= _count)
+        {
+            return;
+        }
+
+        const size_t end = std::min(begin + _chunkSize, _count);
+        TraceScope scope("JobSystem::Chunk");
+        scope.SetCount(end - begin);
+        (*_function)(begin, end);
+    }
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Small pool of worker threads that splits a range of particles into chunks. The calling thread takes part in the
+ * work, so a JobSystem of N threads starts N - 1 workers.
+ *
+ * ```
+ * JobSystem jobs(4);
+ * jobs.ParallelFor(positions.size(), 16384, [&](const size_t begin, const size_t end) {
+ *     for (size_t i = begin; i < end; ++i) { ... }
+ * });
+ * ```
+ */
+class JobSystem
+{
+public:
+    // Particles per chunk below which waking up the workers costs more than it saves
+    static constexpr size_t MIN_PARTICLES_PER_CHUNK = 16384;
+
+    // Number of threads including the caller, 0 uses the number of cores
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Run function(begin, end) over [0, count) in chunks of at least minChunkSize, returns once all chunks are done.
+    // Not reentrant: function must not call ParallelFor.
+    void ParallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)> &function);
+
+    unsigned GetThreadCount() const;
+
+private:
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::condition_variable _done;
+    // Incremented for every ParallelFor so the workers know there is a new job
+    unsigned long long _generation = 0;
+    bool _stopping = false;
+
+    // The current job
+    const std::function<void(size_t, size_t)> *_function = nullptr;
+    size_t _count = 0;
+    size_t _chunkSize = 0;
+    std::atomic<size_t> _nextChunk{0};
+    // Workers that haven't finished the current job yet
+    unsigned _busyWorkers = 0;
+
+    void WorkerLoop(unsigned index);
+    // Grab and run chunks of the current job until there are none left
+    void RunChunks();
+};
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "LifetimeCurves.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    // Particles whose table entries are computed before the lookups, small enough to stay on the stack
+    constexpr size_t BLOCK_SIZE = 256;
+
+    template <typename Key>
+    std::vector<Key> SortedByTime(std::vector<Key> keys)
+    {
+        std::stable_sort(keys.begin(), keys.end(), [](const Key &a, const Key &b) { return a.time < b.time; });
+        return keys;
+    }
+
+    // Piecewise linear value of the curve (keys sorted by time) at time, constant before the first key and after the
+    // last one
+    template <typename Key, typename Value, typename Lerp>
+    Value Evaluate(const std::vector<Key> &keys, const float time, const Value &constant, Lerp &&lerp)
+    {
+        if (keys.empty())
+        {
+            return constant;
+        }
+
+        if (time <= keys.front().time)
+        {
+            return lerp(keys.front(), keys.front(), 0.f);
+        }
+
+        for (size_t i = 1; i < keys.size(); ++i)
+        {
+            if (time <= keys[i].time)
+            {
+                const float span = keys[i].time - keys[i - 1].time;
+                return lerp(keys[i - 1], keys[i], span > 0.f ? (time - keys[i - 1].time) / span : 1.f);
+            }
+        }
+        return lerp(keys.back(), keys.back(), 0.f);
+    }
+
+    std::uint8_t LerpChannel(const std::uint8_t a, const std::uint8_t b, const float t)
+    {
+        return static_cast<std::uint8_t>(std::clamp(a + (b - a) * t + .5f, 0.f, 255.f));
+    }
+} // namespace
+
+CurveLibrary::CurveLibrary()
+{
+    Intern({});
+}
+
+std::uint16_t CurveLibrary::Intern(const LifetimeCurves &curves)
+{
+    const auto found = std::find(_curves.begin(), _curves.end(), curves);
+    if (found != _curves.end())
+    {
+        return static_cast<std::uint16_t>(found - _curves.begin());
+    }
+
+    // Out of ids, fall back to the constant table rather than overflowing
+    if (_curves.size() > std::numeric_limits<std::uint16_t>::max())
+    {
+        return CONSTANT;
+    }
+
+    const auto id = static_cast<std::uint16_t>(_curves.size());
+    _curves.push_back(curves);
+    _colors.resize(_curves.size() * LUT_SIZE);
+    _scales.resize(_curves.size() * LUT_SIZE);
+
+    const auto lerpColor = [](const ColorKey &a, const ColorKey &b, const float t)
+    {
+        return ParticleColor(LerpChannel(a.color.r, b.color.r, t), LerpChannel(a.color.g, b.color.g, t),
+                         LerpChannel(a.color.b, b.color.b, t), LerpChannel(a.color.a, b.color.a, t));
+    };
+    const auto lerpFloat = [](const FloatKey &a, const FloatKey &b, const float t)
+    { return a.value + (b.value - a.value) * t; };
+
+    const std::vector<ColorKey> colors = SortedByTime(curves.colors);
+    const std::vector<FloatKey> alphas = SortedByTime(curves.alphas);
+    const std::vector<FloatKey> scales = SortedByTime(curves.scales);
+    for (size_t i = 0; i < LUT_SIZE; ++i)
+    {
+        // Sample the middle of the age range covered by the entry
+        const float time = (static_cast<float>(i) + .5f) / LUT_SIZE;
+        ParticleColor color = Evaluate(colors, time, ParticleColor::White, lerpColor);
+        const float alpha = Evaluate(alphas, time, 1.f, lerpFloat);
+        color.a = static_cast<std::uint8_t>(std::clamp(color.a * alpha + .5f, 0.f, 255.f));
+        _colors[id * LUT_SIZE + i] = color;
+        _scales[id * LUT_SIZE + i] = Evaluate(scales, time, 1.f, lerpFloat);
+    }
+
+    return id;
+}
+
+void CurveLibrary::WriteVertices(const Particles &particles, const size_t begin, const size_t end,
+                                 ParticleVertex *vertices) const
+{
+    const sf::Vector2f *positions = particles.positions.data();
+    const ParticleStorage::Color *colors = particles.colors.data();
+    const auto &palette = particles.palette;
+
+    // Without any curve every table is the constant one, skip the lookups
+    if (_curves.size() == 1)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            // Through a local: assigned directly, the decoded color made the compiler split the loop per channel
+            const ParticleColor color = palette.Decode(colors[i]);
+            vertices[i].position = positions[i];
+            vertices[i].color = color;
+        }
+        return;
+    }
+
+    const std::uint16_t *curveIds = particles.curveIds.data();
+    const ParticleStorage::LifeTime *lifeTimes = particles.lifeTimes.data();
+    const ParticleStorage::TimeRemainder *timeRemainder = particles.timeRemainder.data();
+    const ParticleColor *table = _colors.data();
+    for (size_t block = begin; block < end; block += BLOCK_SIZE)
+    {
+        const size_t count = std::min(BLOCK_SIZE, end - block);
+
+        // The entries first, a loop without lookups the compiler vectorizes (the division is most of the cost)
+        std::uint32_t entries[BLOCK_SIZE];
+        for (size_t i = 0; i < count; ++i)
+        {
+            const size_t particle = block + i;
+            entries[i] = static_cast<std::uint32_t>(curveIds[particle]) * static_cast<std::uint32_t>(LUT_SIZE) +
+                         static_cast<std::uint32_t>(GetAgeIndex(lifeTimes[particle], timeRemainder[particle]));
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            vertices[block + i].position = positions[block + i];
+            vertices[block + i].color = Modulate(palette.Decode(colors[block + i]), table[entries[i]]);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef LIFETIMECURVES_H
+#define LIFETIMECURVES_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ParticleColor.h"
+#include "ParticleVertex.h"
+#include "Particles.h"
+
+// Key of a curve: value at time, time being the normalized age of the particle (0 at birth, 1 at death)
+struct ColorKey
+{
+    float time = 0.f;
+    ParticleColor color = ParticleColor::White;
+
+    bool operator==(const ColorKey &other) const { return time == other.time && color == other.color; }
+};
+
+struct FloatKey
+{
+    float time = 0.f;
+    float value = 1.f;
+
+    bool operator==(const FloatKey &other) const { return time == other.time && value == other.value; }
+};
+
+// Color, alpha and scale of the particles over their lifetime, as piecewise linear curves. An empty curve is
+// constant (white, opaque, scale 1). The color and alpha modulate the color of the particle.
+struct LifetimeCurves
+{
+    std::vector<ColorKey> colors;
+    std::vector<FloatKey> alphas;
+    std::vector<FloatKey> scales;
+
+    bool IsConstant() const { return colors.empty() && alphas.empty() && scales.empty(); }
+    bool operator==(const LifetimeCurves &other) const
+    {
+        return colors == other.colors && alphas == other.alphas && scales == other.scales;
+    }
+};
+
+/**
+ * The lifetime curves of a ParticleSystem baked into lookup tables of LUT_SIZE entries indexed by the normalized
+ * age. Identical curves are interned once, and the particles only store the id of their table. The vertex pass then
+ * does the same lookup for every particle, whatever the shape of the curve: no per particle interpolation and no
+ * branch on the curve type. The id 0 is the constant table (white, scale 1), used by the particles without curves.
+ */
+class CurveLibrary
+{
+public:
+    static constexpr size_t LUT_SIZE = 256;
+    static constexpr std::uint16_t CONSTANT = 0;
+
+    CurveLibrary();
+
+    // Id of the tables of the curves, baked on first use
+    std::uint16_t Intern(const LifetimeCurves &curves);
+    // Number of baked tables, including the constant one
+    size_t GetSize() const { return _curves.size(); }
+    // The curves the table id was baked from
+    const LifetimeCurves &GetDescription(const std::uint16_t id) const { return _curves[id]; }
+
+    // Index in the tables for a particle: normalized age scaled to the table
+    static size_t GetAgeIndex(float lifeTime, float timeRemainder);
+    // Same from the compact storage, whose time remainder is already normalized
+    static size_t GetAgeIndex(std::uint16_t lifeTime, std::uint16_t timeRemainder);
+    ParticleColor GetColor(std::uint16_t id, size_t ageIndex) const { return _colors[id * LUT_SIZE + ageIndex]; }
+    float GetScale(std::uint16_t id, size_t ageIndex) const { return _scales[id * LUT_SIZE + ageIndex]; }
+    // The base color of a particle multiplied by the color of its curve
+    static ParticleColor Modulate(ParticleColor base, ParticleColor curve);
+
+    // Write the position and the color (modulated by the curves) of the particles [begin, end) into their vertices
+    void WriteVertices(const Particles &particles, size_t begin, size_t end, ParticleVertex *vertices) const;
+
+private:
+    // The descriptions, to find the already baked ones
+    std::vector<LifetimeCurves> _curves;
+    // LUT_SIZE entries per id
+    std::vector<ParticleColor> _colors;
+    std::vector<float> _scales;
+
+    // a * b / 255, rounded, without a division
+    static std::uint8_t Modulate(std::uint8_t a, std::uint8_t b);
+};
+
+inline size_t CurveLibrary::GetAgeIndex(const float lifeTime, const float timeRemainder)
+{
+    // The comparison is written so a NaN (zero lifetime) ends up at 0
+    const float scaled = (1.f - timeRemainder / lifeTime) * LUT_SIZE;
+    const float clamped = std::min(scaled > 0.f ? scaled : 0.f, LUT_SIZE - 1.f);
+    // Through a 32 bits integer, the conversion the SIMD units have
+    return static_cast<std::uint32_t>(static_cast<std::int32_t>(clamped));
+}
+
+inline size_t CurveLibrary::GetAgeIndex(std::uint16_t, const std::uint16_t timeRemainder)
+{
+    static_assert(CompactStorage::TIME_STEPS == 65535);
+    return (static_cast<std::uint32_t>(CompactStorage::TIME_STEPS - timeRemainder) * LUT_SIZE) >> 16;
+}
+
+inline std::uint8_t CurveLibrary::Modulate(const std::uint8_t a, const std::uint8_t b)
+{
+    const unsigned x = a * b + 128u;
+    return static_cast<std::uint8_t>((x + (x >> 8)) >> 8);
+}
+
+inline ParticleColor CurveLibrary::Modulate(const ParticleColor base, const ParticleColor curve)
+{
+    return {Modulate(base.r, curve.r), Modulate(base.g, curve.g), Modulate(base.b, curve.b), Modulate(base.a, curve.a)};
+}
+
+#endif
@@ -0,0 +1,327 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "Noise.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "SimdKernels.h"
+
+#if !defined(PARTICLES_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define PARTICLES_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(sf::Vector2f) == 2 * sizeof(float), "positions are read as interleaved floats");
+
+namespace
+{
+    // Per axis multipliers of the lattice hash, and the seed offset between two octaves
+    constexpr std::uint32_t PRIME_X = 0x8DA6B343u;
+    constexpr std::uint32_t PRIME_Y = 0xD8163841u;
+    constexpr std::uint32_t PRIME_Z = 0xCB1AB31Fu;
+    constexpr std::uint32_t HASH_MULTIPLIER = 0x27D4EB2Du;
+    constexpr std::uint32_t OCTAVE_SEED_STEP = 0x9E3779B9u;
+
+    // ------------------------------------------------------------------------
+    // Scalar
+    //
+
+    std::uint32_t Hash(const std::int32_t x, const std::int32_t y, const std::int32_t z, const std::uint32_t seed)
+    {
+        std::uint32_t h = seed ^ (static_cast<std::uint32_t>(x) * PRIME_X) ^ (static_cast<std::uint32_t>(y) * PRIME_Y) ^
+                          (static_cast<std::uint32_t>(z) * PRIME_Z);
+        h *= HASH_MULTIPLIER;
+        return h ^ (h >> 15);
+    }
+
+    float Fade(const float t)
+    {
+        // 6t^5 - 15t^4 + 10t^3
+        return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+    }
+
+    float Lerp(const float t, const float a, const float b) { return a + t * (b - a); }
+
+    // floor() for the coordinates that fit an int32, inlined instead of a libm call without SSE4.1
+    std::int32_t FastFloor(const float x)
+    {
+        const auto i = static_cast<std::int32_t>(x);
+        return x < static_cast<float>(i) ? i - 1 : i;
+    }
+
+    std::uint32_t ToBits(const float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float FromBits(const std::uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // The hash bits are random, so any branch on them is mispredicted half of the time: select and negate with masks
+
+    // condition ? a : b
+    float Select(const bool condition, const float a, const float b)
+    {
+        const std::uint32_t mask = 0u - static_cast<std::uint32_t>(condition);
+        return FromBits((ToBits(a) & mask) | (ToBits(b) & ~mask));
+    }
+
+    // -value when bit is 1
+    float FlipSign(const float value, const std::uint32_t bit) { return FromBits(ToBits(value) ^ (bit << 31)); }
+
+    // One of the 4 diagonals
+    float Gradient(const std::uint32_t hash, const float x, const float y)
+    {
+        return FlipSign(x, hash & 1) + FlipSign(y, (hash >> 1) & 1);
+    }
+
+    // One of the 12 cube edges (16 cases, 4 of them repeated), as in Ken Perlin's improved noise
+    float Gradient(const std::uint32_t hash, const float x, const float y, const float z)
+    {
+        const std::uint32_t h = hash & 15;
+        const float u = Select(h < 8, x, y);
+        const float v = Select(h < 4, y, Select((h == 12) | (h == 14), x, z));
+        return FlipSign(u, h & 1) + FlipSign(v, (h >> 1) & 1);
+    }
+
+    float Noise2(const float x, const float y, const std::uint32_t seed)
+    {
+        const std::int32_t ix = FastFloor(x);
+        const std::int32_t iy = FastFloor(y);
+        const float tx = x - static_cast<float>(ix);
+        const float ty = y - static_cast<float>(iy);
+
+        const float n00 = Gradient(Hash(ix, iy, 0, seed), tx, ty);
+        const float n10 = Gradient(Hash(ix + 1, iy, 0, seed), tx - 1.f, ty);
+        const float n01 = Gradient(Hash(ix, iy + 1, 0, seed), tx, ty - 1.f);
+        const float n11 = Gradient(Hash(ix + 1, iy + 1, 0, seed), tx - 1.f, ty - 1.f);
+
+        const float u = Fade(tx);
+        return Lerp(Fade(ty), Lerp(u, n00, n10), Lerp(u, n01, n11));
+    }
+
+    float Noise3(const float x, const float y, const float z, const std::uint32_t seed)
+    {
+        const std::int32_t ix = FastFloor(x);
+        const std::int32_t iy = FastFloor(y);
+        const std::int32_t iz = FastFloor(z);
+        const float tx = x - static_cast<float>(ix);
+        const float ty = y - static_cast<float>(iy);
+        const float tz = z - static_cast<float>(iz);
+        const float tx1 = tx - 1.f;
+        const float ty1 = ty - 1.f;
+        const float tz1 = tz - 1.f;
+
+        const float n000 = Gradient(Hash(ix, iy, iz, seed), tx, ty, tz);
+        const float n100 = Gradient(Hash(ix + 1, iy, iz, seed), tx1, ty, tz);
+        const float n010 = Gradient(Hash(ix, iy + 1, iz, seed), tx, ty1, tz);
+        const float n110 = Gradient(Hash(ix + 1, iy + 1, iz, seed), tx1, ty1, tz);
+        const float n001 = Gradient(Hash(ix, iy, iz + 1, seed), tx, ty, tz1);
+        const float n101 = Gradient(Hash(ix + 1, iy, iz + 1, seed), tx1, ty, tz1);
+        const float n011 = Gradient(Hash(ix, iy + 1, iz + 1, seed), tx, ty1, tz1);
+        const float n111 = Gradient(Hash(ix + 1, iy + 1, iz + 1, seed), tx1, ty1, tz1);
+
+        const float u = Fade(tx);
+        const float v = Fade(ty);
+        const float y0 = Lerp(v, Lerp(u, n000, n100), Lerp(u, n010, n110));
+        const float y1 = Lerp(v, Lerp(u, n001, n101), Lerp(u, n011, n111));
+        return Lerp(Fade(tz), y0, y1);
+    }
+
+    float FractalScalar(const float x, const float y, const float z, const NoiseSettings &settings,
+                        const std::uint32_t seed, const float normalization)
+    {
+        float sum = 0.f;
+        float frequency = settings.frequency;
+        float amplitude = 1.f;
+        for (int octave = 0; octave < settings.octaves; ++octave)
+        {
+            const std::uint32_t octaveSeed = seed + static_cast<std::uint32_t>(octave) * OCTAVE_SEED_STEP;
+            sum += amplitude * Noise3(x * frequency, y * frequency, z * frequency, octaveSeed);
+            frequency *= settings.lacunarity;
+            amplitude *= settings.gain;
+        }
+        return sum * normalization;
+    }
+
+    // 1 / sum of the octave amplitudes, so the fractal noise stays in the range of a single octave
+    float Normalization(const NoiseSettings &settings)
+    {
+        float total = 0.f;
+        float amplitude = 1.f;
+        for (int octave = 0; octave < settings.octaves; ++octave)
+        {
+            total += amplitude;
+            amplitude *= settings.gain;
+        }
+        return total > 0.f ? 1.f / total : 0.f;
+    }
+
+    void EvaluateScalar(const float *positions, float *out, const size_t count, const float z,
+                        const NoiseSettings &settings, const std::uint32_t seed, const float normalization)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = FractalScalar(positions[i * 2], positions[i * 2 + 1], z, settings, seed, normalization);
+        }
+    }
+
+#ifdef PARTICLES_SIMD_AVX2
+    // ------------------------------------------------------------------------
+    // AVX2, 8 positions per iteration
+    //
+
+    __attribute__((target("avx2"))) inline __m256i HashAVX2(const __m256i x, const __m256i y, const __m256i z,
+                                                            const __m256i seed)
+    {
+        __m256i h = _mm256_xor_si256(seed, _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(PRIME_X))));
+        h = _mm256_xor_si256(h, _mm256_mullo_epi32(y, _mm256_set1_epi32(static_cast<int>(PRIME_Y))));
+        h = _mm256_xor_si256(h, _mm256_mullo_epi32(z, _mm256_set1_epi32(static_cast<int>(PRIME_Z))));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(HASH_MULTIPLIER)));
+        return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    }
+
+    __attribute__((target("avx2"))) inline __m256 FadeAVX2(const __m256 t)
+    {
+        const __m256 inner = _mm256_add_ps(
+                _mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.f)), _mm256_set1_ps(15.f))),
+                _mm256_set1_ps(10.f));
+        return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+    }
+
+    __attribute__((target("avx2"))) inline __m256 LerpAVX2(const __m256 t, const __m256 a, const __m256 b)
+    {
+        return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+    }
+
+    __attribute__((target("avx2"))) inline __m256 GradientAVX2(const __m256i hash, const __m256 x, const __m256 y,
+                                                               const __m256 z)
+    {
+        const __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+
+        // u = h < 8 ? x : y, v = h < 4 ? y : (h == 12 || h == 14 ? x : z)
+        const __m256 below8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+        const __m256 below4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+        const __m256i is12 = _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12));
+        const __m256i is14 = _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14));
+        const __m256 is12or14 = _mm256_castsi256_ps(_mm256_or_si256(is12, is14));
+        const __m256 u = _mm256_blendv_ps(y, x, below8);
+        const __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, is12or14), y, below4);
+
+        // Negate by flipping the sign bit: bit 0 of h for u, bit 1 for v
+        const __m256 signU = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+        const __m256 signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+        return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+    }
+
+    __attribute__((target("avx2"))) inline __m256 Noise3AVX2(const __m256 x, const __m256 y, const __m256 z,
+                                                             const __m256i seed)
+    {
+        const __m256 fx = _mm256_floor_ps(x);
+        const __m256 fy = _mm256_floor_ps(y);
+        const __m256 fz = _mm256_floor_ps(z);
+        const __m256i ix = _mm256_cvttps_epi32(fx);
+        const __m256i iy = _mm256_cvttps_epi32(fy);
+        const __m256i iz = _mm256_cvttps_epi32(fz);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i ix1 = _mm256_add_epi32(ix, one);
+        const __m256i iy1 = _mm256_add_epi32(iy, one);
+        const __m256i iz1 = _mm256_add_epi32(iz, one);
+        const __m256 tx = _mm256_sub_ps(x, fx);
+        const __m256 ty = _mm256_sub_ps(y, fy);
+        const __m256 tz = _mm256_sub_ps(z, fz);
+        const __m256 oneF = _mm256_set1_ps(1.f);
+        const __m256 tx1 = _mm256_sub_ps(tx, oneF);
+        const __m256 ty1 = _mm256_sub_ps(ty, oneF);
+        const __m256 tz1 = _mm256_sub_ps(tz, oneF);
+
+        const __m256 n000 = GradientAVX2(HashAVX2(ix, iy, iz, seed), tx, ty, tz);
+        const __m256 n100 = GradientAVX2(HashAVX2(ix1, iy, iz, seed), tx1, ty, tz);
+        const __m256 n010 = GradientAVX2(HashAVX2(ix, iy1, iz, seed), tx, ty1, tz);
+        const __m256 n110 = GradientAVX2(HashAVX2(ix1, iy1, iz, seed), tx1, ty1, tz);
+        const __m256 n001 = GradientAVX2(HashAVX2(ix, iy, iz1, seed), tx, ty, tz1);
+        const __m256 n101 = GradientAVX2(HashAVX2(ix1, iy, iz1, seed), tx1, ty, tz1);
+        const __m256 n011 = GradientAVX2(HashAVX2(ix, iy1, iz1, seed), tx, ty1, tz1);
+        const __m256 n111 = GradientAVX2(HashAVX2(ix1, iy1, iz1, seed), tx1, ty1, tz1);
+
+        const __m256 u = FadeAVX2(tx);
+        const __m256 v = FadeAVX2(ty);
+        const __m256 y0 = LerpAVX2(v, LerpAVX2(u, n000, n100), LerpAVX2(u, n010, n110));
+        const __m256 y1 = LerpAVX2(v, LerpAVX2(u, n001, n101), LerpAVX2(u, n011, n111));
+        return LerpAVX2(FadeAVX2(tz), y0, y1);
+    }
+
+    __attribute__((target("avx2"))) void EvaluateAVX2(const float *positions, float *out, const size_t count,
+                                                      const float z, const NoiseSettings &settings,
+                                                      const std::uint32_t seed, const float normalization)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            // Deinterleave 8 x, y pairs: the shuffle works per 128-bit lane, the permute restores the order
+            const __m256 a = _mm256_loadu_ps(positions + i * 2);
+            const __m256 b = _mm256_loadu_ps(positions + i * 2 + 8);
+            const __m256 x = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                    _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+            const __m256 y = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                    _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+            const __m256 vz = _mm256_set1_ps(z);
+
+            __m256 sum = _mm256_setzero_ps();
+            float frequency = settings.frequency;
+            float amplitude = 1.f;
+            for (int octave = 0; octave < settings.octaves; ++octave)
+            {
+                const std::uint32_t octaveSeed = seed + static_cast<std::uint32_t>(octave) * OCTAVE_SEED_STEP;
+                const __m256 f = _mm256_set1_ps(frequency);
+                const __m256 n = Noise3AVX2(_mm256_mul_ps(x, f), _mm256_mul_ps(y, f), _mm256_mul_ps(vz, f),
+                                            _mm256_set1_epi32(static_cast<int>(octaveSeed)));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(amplitude), n));
+                frequency *= settings.lacunarity;
+                amplitude *= settings.gain;
+            }
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(sum, _mm256_set1_ps(normalization)));
+        }
+
+        // Leave the upper halves clean before the scalar tail and the caller's SSE code
+        _mm256_zeroupper();
+        EvaluateScalar(positions + i * 2, out + i, count - i, z, settings, seed, normalization);
+    }
+
+#endif
+} // namespace
+
+Noise::Noise(const std::uint32_t seed) : _seed(seed) {}
+
+float Noise::Sample(const float x, const float y) const { return Noise2(x, y, _seed); }
+
+float Noise::Sample(const float x, const float y, const float z) const { return Noise3(x, y, z, _seed); }
+
+float Noise::Fractal(const float x, const float y, const float z, const NoiseSettings &settings) const
+{
+    return FractalScalar(x, y, z, settings, _seed, Normalization(settings));
+}
+
+void Noise::Evaluate(const sf::Vector2f *positions, float *out, const std::size_t count, const float z,
+                     const NoiseSettings &settings) const
+{
+    const auto *values = reinterpret_cast<const float *>(positions);
+    const float normalization = Normalization(settings);
+
+#ifdef PARTICLES_SIMD_AVX2
+    if (SimdKernels::GetLevel() == SimdLevel::AVX2)
+    {
+        EvaluateAVX2(values, out, count, z, settings, _seed, normalization);
+        return;
+    }
+#endif
+
+    EvaluateScalar(values, out, count, z, settings, _seed, normalization);
+}
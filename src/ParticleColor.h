@@ -0,0 +1,53 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef PARTICLECOLOR_H
+#define PARTICLECOLOR_H
+
+#include <cstdint>
+
+/**
+ * RGBA color of a particle, 8 bits per channel. The core has its own so it doesn't depend on the graphics module of
+ * SFML; it has the layout of sf::Color (see ParticleVertex), the render layer converts between the two.
+ */
+struct ParticleColor
+{
+    std::uint8_t r = 0;
+    std::uint8_t g = 0;
+    std::uint8_t b = 0;
+    std::uint8_t a = 255;
+
+    constexpr ParticleColor() = default;
+    constexpr ParticleColor(const std::uint8_t red, const std::uint8_t green, const std::uint8_t blue,
+                            const std::uint8_t alpha = 255)
+        : r(red)
+        , g(green)
+        , b(blue)
+        , a(alpha)
+    {
+    }
+
+    constexpr bool operator==(const ParticleColor &other) const
+    {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+    constexpr bool operator!=(const ParticleColor &other) const { return !(*this == other); }
+
+    static const ParticleColor Black;
+    static const ParticleColor White;
+    static const ParticleColor Red;
+    static const ParticleColor Yellow;
+    static const ParticleColor Magenta;
+    static const ParticleColor Cyan;
+    static const ParticleColor Transparent;
+};
+
+inline constexpr ParticleColor ParticleColor::Black(0, 0, 0);
+inline constexpr ParticleColor ParticleColor::White(255, 255, 255);
+inline constexpr ParticleColor ParticleColor::Red(255, 0, 0);
+inline constexpr ParticleColor ParticleColor::Yellow(255, 255, 0);
+inline constexpr ParticleColor ParticleColor::Magenta(255, 0, 255);
+inline constexpr ParticleColor ParticleColor::Cyan(0, 255, 255);
+inline constexpr ParticleColor ParticleColor::Transparent(0, 0, 0, 0);
+
+#endif
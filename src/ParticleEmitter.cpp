@@ -2,68 +2,25 @@
 
 #include "ParticleEmitter.h"
 
-#include <iostream>
-
-#include "ParticleSystem.h"
-#include "Randomizer.h"
-
-#include <bits/ostream.tcc>
-#include <random>
-
-ParticleEmitter::ParticleEmitter(ParticleSystem &system, const sf::Vector2f &position)
-    : _system(system)
+ParticleEmitter::ParticleEmitter(const sf::Vector2f &position)
 {
     // Randomizer::SetDistributionType(DistributionType::Gaussian);
     // Randomizer::ResetNoiseIndex();
     _emitterProps.position = position;
 }
 
-void ParticleEmitter::Update(const sf::Time &time)
-{
-    _timeElapsed += time.asSeconds();
-    _active = _timeElapsed < _emitterProps.duration;
-    if (_active)
-    {
-        // Emit the Particles in the System
-        Emit(time);
-    }
-}
-
-void ParticleEmitter::Emit(const sf::Time &time)
+ParticleEmitter::ParticleEmitter(const EmitterProperties &emitterProps, const ParticleProperties &particleProps)
+    : _particleProps(particleProps)
+    , _emitterProps(emitterProps)
 {
-    // Use the emissionRate to determine if particles should be emitted
-    const float emissionInterval = 1.0f / _emitterProps.emissionRate;
-    _emissionAccumulator += time.asSeconds();
-
-    if (_emissionAccumulator >= emissionInterval)
-    {
-        // Calculate how many emissions should occur
-        const int emissionCount = static_cast<int>(_emissionAccumulator / emissionInterval);
-        _emissionAccumulator -= emissionCount * emissionInterval;
-
-        // Emit particles based on the calculated emission count
-        for (int e = 0; e < emissionCount; ++e)
-        {
-            for (int i = 0; i < _emitterProps.particlesPerEmission; ++i)
-            {
-                const auto direction =
-                        Randomizer::RandomDirectionalVector(_emitterProps.direction, _emitterProps.angle).normalized() *
-                        Randomizer::RandomFloat(_particleProps.minVelocity, _particleProps.maxVelocity);
-
-                const float lifeTime = Randomizer::RandomFloat(_particleProps.minLifetime, _particleProps.maxLifetime);
-
-                // Generate particles
-                _system.SpawnParticle(_emitterProps.position, direction, _particleProps.color, lifeTime);
-            }
-        }
-    }
 }
 
 // ----------------------------------------------------------------------------
 // Getters
 //
 
-bool ParticleEmitter::IsActive() const { return _active; }
+const ParticleEmitter::ParticleProperties &ParticleEmitter::GetParticleProperties() const { return _particleProps; }
+const ParticleEmitter::EmitterProperties &ParticleEmitter::GetEmitterProperties() const { return _emitterProps; }
 
 // ----------------------------------------------------------------------------
 // Setters
@@ -82,20 +39,41 @@ void ParticleEmitter::SetLifetime(const float &min, const float &max)
 void ParticleEmitter::SetPosition(const sf::Vector2f &position) { _emitterProps.position = position; }
 void ParticleEmitter::SetDirection(const sf::Vector2f &direction) { _emitterProps.direction = direction; }
 void ParticleEmitter::SetAngle(const float &angle) { _emitterProps.angle = angle; }
-void ParticleEmitter::SetDuration(const float &duration)
+void ParticleEmitter::SetDuration(const float &duration) { _emitterProps.duration = duration; }
+void ParticleEmitter::SetColor(const ParticleColor &color) { _particleProps.color = color; }
+void ParticleEmitter::SetParticlesPerEmission(const unsigned int &count) { _emitterProps.particlesPerEmission = count; }
+void ParticleEmitter::SetEmissionRate(const float &emissionsPerSecond)
 {
-    _emitterProps.duration = duration;
-    _timeElapsed = 0.f;
+    _emitterProps.emissionRate = emissionsPerSecond;
 }
-void ParticleEmitter::SetColor(const sf::Color &color) { _particleProps.color = color; }
-void ParticleEmitter::SetActive(const bool &active)
+void ParticleEmitter::SetColorOverLifetime(const ParticleColor &start, const ParticleColor &end)
 {
-    _active = active;
-    _timeElapsed = 0.f;
+    _particleProps.startColor = start;
+    _particleProps.endColor = end;
+    _particleProps.curves.colors = {{0.f, start}, {1.f, end}};
 }
-void ParticleEmitter::SetParticlesPerEmission(const unsigned int &count) { _emitterProps.particlesPerEmission = count; }
-void ParticleEmitter::SetEmissionRate(const float &emissionsPerSecond)
+void ParticleEmitter::SetAlphaOverLifetime(const float &start, const float &end)
 {
-    _emitterProps.emissionRate = emissionsPerSecond;
-    _emissionAccumulator = 0.f;
+    _particleProps.curves.alphas = {{0.f, start}, {1.f, end}};
+}
+void ParticleEmitter::SetScaleOverLifetime(const float &start, const float &end)
+{
+    _particleProps.curves.scales = {{0.f, start}, {1.f, end}};
+}
+void ParticleEmitter::SetLifetimeCurves(const LifetimeCurves &curves) { _particleProps.curves = curves; }
+void ParticleEmitter::SetSize(const float &min, const float &max)
+{
+    _particleProps.minSize = min;
+    _particleProps.maxSize = max;
+}
+void ParticleEmitter::SetRotation(const float &min, const float &max)
+{
+    _particleProps.minRotation = min;
+    _particleProps.maxRotation = max;
+}
+void ParticleEmitter::SetSpin(const float &min, const float &max)
+{
+    _particleProps.minSpin = min;
+    _particleProps.maxSpin = max;
 }
+void ParticleEmitter::SetAtlasFrame(const std::uint16_t &frame) { _particleProps.frame = frame; }
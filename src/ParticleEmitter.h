@@ -4,60 +4,55 @@
 #ifndef PARTICLEEMITTER_H
 #define PARTICLEEMITTER_H
 
-#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
 #include <math.h>
 
-// Forward Declaration
-class ParticleSystem;
+#include "LifetimeCurves.h"
+#include "ParticleColor.h"
+
+/**
+ * Description of an emitter: a plain value configured with the setters and then spawned into a ParticleSystem,
+ * which copies it into its EmitterPool. Changing it afterward doesn't affect the spawned emitter.
+ *
+ * ```
+ * ParticleEmitter smoke(position);
+ * smoke.SetDuration(5.f);
+ * const EmitterHandle handle = particleSystem.SpawnEmitter(smoke);
+ * ```
+ */
 class ParticleEmitter
 {
 public:
-    ParticleEmitter(ParticleSystem &system, const sf::Vector2f &position);
-    ~ParticleEmitter() = default;
-
-    // Time calculation to deactivate the Emitter
-    void Update(const sf::Time &time);
-
-    // Actually generate the particles and add them to the ParticleSystem
-    void Emit(const sf::Time &time);
-
-    // Getters
-    bool IsActive() const;
-
-    // Setters
-    void SetPosition(const sf::Vector2f &position);
-    void SetDirection(const sf::Vector2f &direction);
-    void SetAngle(const float &angle);
-    void SetDuration(const float &duration);
-    void SetColor(const sf::Color &color);
-    void SetActive(const bool &active);
-    void SetParticlesPerEmission(const unsigned int &count);
-    void SetEmissionRate(const float &emissionsPerSecond);
-    void SetVelocity(const float &min, const float &max);
-    void SetLifetime(const float &min, const float &max);
-
-private:
-    // A reference to the particle system where we'll emit particles
-    ParticleSystem &_system;
-
     // ---------------------------------------------------------------------------------
     // Configuration
     //
 
-    struct
+    struct ParticleProperties
     {
-        // Color of the vertices
-        sf::Color color = sf::Color::White;
-        sf::Color startColor = sf::Color::White;
-        sf::Color endColor = sf::Color::Transparent;
+        // Color of the vertices, modulated by the curves
+        ParticleColor color = ParticleColor::White;
+        // Ends of the color curve set by SetColorOverLifetime
+        ParticleColor startColor = ParticleColor::White;
+        ParticleColor endColor = ParticleColor::Transparent;
+        // Color, alpha and scale over the lifetime of the particles
+        LifetimeCurves curves;
         float minLifetime = 1.0f;
         float maxLifetime = 3.0f;
         // Initial velocity of the particle
         float minVelocity = 1.0f;
         float maxVelocity = 2.0f;
-    } _particleProps;
+        // Textured quads only: size in pixels, rotation at birth and angular speed (radians), frame of the atlas
+        float minSize = 1.0f;
+        float maxSize = 1.0f;
+        float minRotation = 0.f;
+        float maxRotation = 0.f;
+        float minSpin = 0.f;
+        float maxSpin = 0.f;
+        std::uint16_t frame = 0;
+    };
 
-    struct
+    struct EmitterProperties
     {
         // Position of the Emitter and direction of the emission
         sf::Vector2f position;
@@ -71,18 +66,42 @@ private:
         unsigned int particlesPerEmission = 10;
         // How many times per second to emit particles
         float emissionRate = 10.f;
-    } _emitterProps;
+    };
 
-    // ---------------------------------------------------------------------------------
-    // States
-    //
+    explicit ParticleEmitter(const sf::Vector2f &position);
+    // All the values at once, used to restore a recorded emitter (see SceneRecording)
+    ParticleEmitter(const EmitterProperties &emitterProps, const ParticleProperties &particleProps);
+    ~ParticleEmitter() = default;
 
-    // Is the emitter active?
-    bool _active = false;
-    // Time Accumulator (reset to 0.0f when the duration is changed)
-    float _timeElapsed = 0.0f;
-    // Time since last emission (set to 0.0f when the emissionRate is changed)
-    float _emissionAccumulator = 0.0f;
+    // Getters
+    const ParticleProperties &GetParticleProperties() const;
+    const EmitterProperties &GetEmitterProperties() const;
+
+    // Setters
+    void SetPosition(const sf::Vector2f &position);
+    void SetDirection(const sf::Vector2f &direction);
+    void SetAngle(const float &angle);
+    void SetDuration(const float &duration);
+    void SetColor(const ParticleColor &color);
+    void SetParticlesPerEmission(const unsigned int &count);
+    void SetEmissionRate(const float &emissionsPerSecond);
+    void SetVelocity(const float &min, const float &max);
+    void SetLifetime(const float &min, const float &max);
+    // Lifetime curves, from the birth of the particles to their death. The color curve modulates the color, keep
+    // it white for the curve to give the absolute colors.
+    void SetColorOverLifetime(const ParticleColor &start, const ParticleColor &end);
+    void SetAlphaOverLifetime(const float &start, const float &end);
+    void SetScaleOverLifetime(const float &start, const float &end);
+    void SetLifetimeCurves(const LifetimeCurves &curves);
+    // Appearance of the particles drawn as textured quads (see ParticleRenderer::SetMode), ignored by the points
+    void SetSize(const float &min, const float &max);
+    void SetRotation(const float &min, const float &max);
+    void SetSpin(const float &min, const float &max);
+    void SetAtlasFrame(const std::uint16_t &frame);
+
+private:
+    ParticleProperties _particleProps;
+    EmitterProperties _emitterProps;
 };
 
 
@@ -0,0 +1,217 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "ParticleRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "DirectionSampler.h"
+#include "ParticleSystem.h"
+#include "Tracer.h"
+
+namespace
+{
+    constexpr size_t VERTICES_PER_QUAD = 6;
+
+    // The vertices of the core are drawn as is, they need the layout of the SFML ones
+    static_assert(sizeof(ParticleVertex) == sizeof(sf::Vertex));
+    static_assert(offsetof(ParticleVertex, position) == offsetof(sf::Vertex, position));
+    static_assert(offsetof(ParticleVertex, color) == offsetof(sf::Vertex, color));
+    static_assert(offsetof(ParticleVertex, texCoords) == offsetof(sf::Vertex, texCoords));
+
+    const sf::Vertex *ToSfml(const ParticleVertex *vertices) { return reinterpret_cast<const sf::Vertex *>(vertices); }
+    sf::Color ToSfml(const ParticleColor color) { return {color.r, color.g, color.b, color.a}; }
+
+    // Write the two triangles of the particles [begin, end), 6 vertices per particle
+    void BuildQuads(const Particles &particles, const CurveLibrary &curves, const sf::FloatRect *frames,
+                    const size_t frameCount, const float delay, sf::Vertex *vertices, const size_t begin,
+                    const size_t end)
+    {
+        // The full ring: the table turns a rotation into its cos/sin without any trigonometry
+        const DirectionSampler ring({0.f, 0.f}, 0.f);
+        constexpr float turnsPerRadian = static_cast<float>(1 / (2 * M_PI));
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const size_t age = CurveLibrary::GetAgeIndex(particles.lifeTimes[i], particles.timeRemainder[i]);
+            const std::uint16_t curve = particles.curveIds[i];
+            const sf::Color color = ToSfml(CurveLibrary::Modulate(particles.GetColor(i), curves.GetColor(curve, age)));
+
+            // Half extents along the rotated axes
+            const float rotation = particles.rotations[i] + particles.spins[i] * particles.GetAge(i);
+            float turns = rotation * turnsPerRadian;
+            turns -= std::floor(turns);
+            const sf::Vector2f unit = ring.Sample(turns);
+            const float scale = curves.GetScale(curve, age) * .5f;
+            const sf::Vector2f axisX = unit * (particles.scales[i].x * scale);
+            const sf::Vector2f axisY = sf::Vector2f(-unit.y, unit.x) * (particles.scales[i].y * scale);
+
+            const sf::FloatRect &frame = frames[std::min<size_t>(particles.frames[i], frameCount - 1)];
+            const sf::Vector2f position = delay > 0.f ? particles.GetPosition(i, delay) : particles.positions[i];
+            const sf::Vector2f texTopLeft = frame.position;
+            const sf::Vector2f texBottomRight = frame.position + frame.size;
+            const sf::Vertex topLeft{position - axisX - axisY, color, texTopLeft};
+            const sf::Vertex topRight{position + axisX - axisY, color, {texBottomRight.x, texTopLeft.y}};
+            const sf::Vertex bottomRight{position + axisX + axisY, color, texBottomRight};
+            const sf::Vertex bottomLeft{position - axisX + axisY, color, {texTopLeft.x, texBottomRight.y}};
+
+            sf::Vertex *quad = vertices + i * VERTICES_PER_QUAD;
+            quad[0] = topLeft;
+            quad[1] = topRight;
+            quad[2] = bottomRight;
+            quad[3] = topLeft;
+            quad[4] = bottomRight;
+            quad[5] = bottomLeft;
+        }
+    }
+} // namespace
+
+ParticleRenderer::ParticleRenderer()
+    : _frames(1)
+    , _pointStream(sf::PrimitiveType::Points)
+    , _quadStream(sf::PrimitiveType::Triangles)
+{
+}
+
+void ParticleRenderer::SetMode(const RenderMode mode) { _mode = mode; }
+RenderMode ParticleRenderer::GetMode() const { return _mode; }
+
+void ParticleRenderer::SetTexture(const sf::Texture *texture, const std::vector<sf::FloatRect> &frames)
+{
+    _texture = texture;
+    _frames = frames;
+    if (_frames.empty())
+    {
+        const sf::Vector2f size = texture ? sf::Vector2f(texture->getSize()) : sf::Vector2f();
+        _frames.emplace_back(sf::Vector2f(), size);
+    }
+}
+
+void ParticleRenderer::SetStreamBuffers(const unsigned count)
+{
+    _pointStream.SetBufferCount(count);
+    _quadStream.SetBufferCount(count);
+}
+
+const sf::Vertex *ParticleRenderer::GetQuadVertices() const { return _quadVertices.data(); }
+size_t ParticleRenderer::GetQuadVertexCount() const { return _quadVertexCount; }
+
+void ParticleRenderer::Update(const ParticleSystem &system)
+{
+    _stats = &system.GetStats();
+    PARTICLES_STAT_SCOPE(*_stats, StatStage::VertexBuild);
+    PARTICLES_TRACE_SCOPE("ParticleRenderer::Update");
+
+    if (_mode == RenderMode::TexturedQuads)
+    {
+        UpdateQuads(system);
+        return;
+    }
+
+    // The fused vertices have the positions of the last step, interpolating needs its own build
+    const float delay = system.GetRenderDelay();
+    if (system.IsFusedVertexBuild() && delay == 0.f)
+    {
+        // Already built by the update
+        _fusedVertices = &system.GetVertices();
+        _pointCount = 0;
+        return;
+    }
+
+    _fusedVertices = nullptr;
+    const Particles &particles = system.GetParticles();
+    const size_t count = particles.positions.size();
+
+    // Grow the vertices to the number of particles, never shrink them so they aren't rebuilt every frame
+    _pointCount = count;
+    if (_points.size() < count)
+    {
+        _points.resize(count);
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Update each vertex with its particle data and lifetime curves, split over the worker pool of the system if it
+    // has one
+    ParticleVertex *vertices = _points.data();
+    const CurveLibrary *curves = &system.GetCurves();
+    const Particles *source = &particles;
+    const auto buildVertices = [=](const size_t begin, const size_t end)
+    {
+        curves->WriteVertices(*source, begin, end, vertices);
+        if (delay > 0.f)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                vertices[i].position = source->GetPosition(i, delay);
+            }
+        }
+    };
+
+    if (JobSystem *jobs = system.GetJobSystem())
+    {
+        jobs->ParallelFor(count, JobSystem::MIN_PARTICLES_PER_CHUNK, buildVertices);
+    }
+    else
+    {
+        buildVertices(0, count);
+    }
+}
+
+void ParticleRenderer::Render(sf::RenderTarget &target)
+{
+    // Nothing was built before the first Update
+    if (!_stats)
+    {
+        return;
+    }
+    PARTICLES_STAT_SCOPE(*_stats, StatStage::Render);
+    PARTICLES_TRACE_SCOPE("ParticleRenderer::Render");
+
+    if (_mode == RenderMode::TexturedQuads)
+    {
+        _quadStream.Draw(target, _quadVertices.data(), _quadVertexCount, sf::RenderStates(_texture));
+        return;
+    }
+
+    if (_fusedVertices)
+    {
+        _pointStream.Draw(target, ToSfml(_fusedVertices->data()), _fusedVertices->size());
+        return;
+    }
+
+    _pointStream.Draw(target, ToSfml(_points.data()), _pointCount);
+}
+
+void ParticleRenderer::UpdateQuads(const ParticleSystem &system)
+{
+    const Particles &particles = system.GetParticles();
+    const size_t count = particles.positions.size();
+    _fusedVertices = nullptr;
+    _pointCount = 0;
+    _quadVertexCount = count * VERTICES_PER_QUAD;
+    if (_quadVertices.size() < _quadVertexCount)
+    {
+        _quadVertices.resize(_quadVertexCount);
+    }
+
+    sf::Vertex *vertices = _quadVertices.data();
+    const Particles *source = &particles;
+    const CurveLibrary *curves = &system.GetCurves();
+    const sf::FloatRect *frames = _frames.data();
+    const size_t frameCount = _frames.size();
+    const float delay = system.GetRenderDelay();
+    const auto buildQuads = [=](const size_t begin, const size_t end)
+    { BuildQuads(*source, *curves, frames, frameCount, delay, vertices, begin, end); };
+    if (JobSystem *jobs = system.GetJobSystem())
+    {
+        jobs->ParallelFor(count, JobSystem::MIN_PARTICLES_PER_CHUNK, buildQuads);
+    }
+    else
+    {
+        buildQuads(0, count);
+    }
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef PARTICLERENDERER_H
+#define PARTICLERENDERER_H
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <vector>
+
+#include "ParticleStats.h"
+#include "ParticleVertex.h"
+#include "VertexStream.h"
+
+// Forward Declaration
+class ParticleSystem;
+
+// How the particles are drawn
+enum class RenderMode
+{
+    // One pixel per particle, the only mode the fused vertex build of the system produces
+    Points,
+    // Two triangles per particle, with its size, rotation, scale curve and frame of the texture atlas
+    TexturedQuads
+};
+
+/**
+ * Render layer of the particle system. The simulation in ParticleSystem never draws, it only owns the particle
+ * data; the renderer copies that data into SFML vertices once per frame and submits them to a render target.
+ *
+ * When the system builds its vertices during the update (ParticleSystem::SetFusedVertexBuild), the renderer skips
+ * the copy and draws the vertices of the system directly.
+ *
+ * The textured quads are built in one pass over the particles, split over the worker pool of the system. The
+ * vertices of both modes are kept in client arrays that only grow, and Render streams the live range into a ring of
+ * persistent vertex buffers (see VertexStream) drawn with a single call. Without vertex buffer support they are drawn
+ * from client memory, so both modes also run on the OpenGL implementations without it.
+ *
+ * With a fixed timestep and interpolation (ParticleSystem::SetInterpolation), the positions are moved back along the
+ * velocities by the render delay of the system, so the frames in between two steps still move smoothly.
+ */
+class ParticleRenderer
+{
+public:
+    ParticleRenderer();
+    ~ParticleRenderer() = default;
+
+    void SetMode(RenderMode mode);
+    RenderMode GetMode() const;
+    // Texture of the quads and its atlas frames in pixels, indexed by the frame of the particles (clamped to the last
+    // one). No frames uses the whole texture, no texture draws plain colored quads. The texture must outlive the
+    // renderer.
+    void SetTexture(const sf::Texture *texture, const std::vector<sf::FloatRect> &frames = {});
+    // Vertex buffers the vertices are streamed through (double buffered by default), 0 draws them from client
+    // memory every frame
+    void SetStreamBuffers(unsigned count);
+
+    // Rebuild the vertices from the current state of the particle system
+    void Update(const ParticleSystem &system);
+    // Render function with render target, uploads the vertices built by Update first
+    void Render(sf::RenderTarget &target);
+
+    // The quads built by the last Update, 6 vertices per particle
+    const sf::Vertex *GetQuadVertices() const;
+    size_t GetQuadVertexCount() const;
+
+private:
+    RenderMode _mode = RenderMode::Points;
+
+    // Vertices of the points, built by the core and drawn as SFML vertices. Only grows, _pointCount are used.
+    std::vector<ParticleVertex> _points;
+    size_t _pointCount = 0;
+    // The vertices of the system when it builds them itself, nullptr otherwise
+    const std::vector<ParticleVertex> *_fusedVertices = nullptr;
+
+    const sf::Texture *_texture = nullptr;
+    // Never empty, texture coordinates in pixels
+    std::vector<sf::FloatRect> _frames;
+    // Only grows, _quadVertexCount are used
+    std::vector<sf::Vertex> _quadVertices;
+    size_t _quadVertexCount = 0;
+
+    // Of the system given to the last Update, where the build and the render are timed
+    ParticleStats *_stats = nullptr;
+
+    VertexStream _pointStream;
+    VertexStream _quadStream;
+
+    void UpdateQuads(const ParticleSystem &system);
+};
+
+#endif
@@ -0,0 +1,400 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "ParticleSnapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "ParticleSystem.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PARTICLES_SNAPSHOT_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // "PSNP" read as a little endian integer
+    constexpr std::uint32_t MAGIC = 0x504E5350;
+
+    struct FileHeader
+    {
+        std::uint32_t magic = MAGIC;
+        std::uint32_t version = ParticleSnapshot::VERSION;
+        // 0 for FullStorage, 1 for CompactStorage
+        std::uint32_t storage = 0;
+        std::uint32_t arrayCount = 0;
+        std::uint64_t fileSize = 0;
+        std::uint64_t steps = 0;
+        float time = 0.f;
+        std::uint32_t reserved = 0;
+    };
+
+    struct ArrayEntry
+    {
+        std::uint64_t offset = 0;
+        std::uint64_t count = 0;
+        std::uint32_t elementSize = 0;
+        std::uint32_t reserved = 0;
+    };
+
+    constexpr std::uint32_t STORAGE = std::is_same_v<ParticleStorage, CompactStorage> ? 1 : 0;
+
+    std::uint64_t AlignUp(const std::uint64_t offset)
+    {
+        return (offset + ParticleSnapshot::ALIGNMENT - 1) / ParticleSnapshot::ALIGNMENT * ParticleSnapshot::ALIGNMENT;
+    }
+
+    template <typename Array>
+    constexpr std::uint32_t ElementSize()
+    {
+        using Element = typename std::decay_t<Array>::value_type;
+        static_assert(std::is_trivially_copyable_v<Element>, "the arrays are stored as in memory");
+        return sizeof(Element);
+    }
+
+    // The curves of the library flattened into arrays: 3 key counts per curve (colors, alphas, scales), then the keys
+    // of all the curves one after the other. The constant curve (id 0) is implicit.
+    struct CurveArrays
+    {
+        static constexpr size_t ARRAY_COUNT = 4;
+
+        std::vector<std::uint32_t> keyCounts;
+        std::vector<ColorKey> colors;
+        std::vector<FloatKey> alphas;
+        std::vector<FloatKey> scales;
+
+        explicit CurveArrays(const CurveLibrary *library = nullptr)
+        {
+            for (size_t id = 1; library && id < library->GetSize(); ++id)
+            {
+                const LifetimeCurves &curves = library->GetDescription(static_cast<std::uint16_t>(id));
+                keyCounts.push_back(static_cast<std::uint32_t>(curves.colors.size()));
+                keyCounts.push_back(static_cast<std::uint32_t>(curves.alphas.size()));
+                keyCounts.push_back(static_cast<std::uint32_t>(curves.scales.size()));
+                colors.insert(colors.end(), curves.colors.begin(), curves.colors.end());
+                alphas.insert(alphas.end(), curves.alphas.begin(), curves.alphas.end());
+                scales.insert(scales.end(), curves.scales.begin(), curves.scales.end());
+            }
+        }
+
+        // Intern the curves in their order, which gives them back their id. False if the counts don't match the keys
+        // or a curve doesn't get its id back.
+        bool Restore(CurveLibrary &library) const
+        {
+            if (keyCounts.size() % 3 != 0)
+            {
+                return false;
+            }
+
+            size_t color = 0;
+            size_t alpha = 0;
+            size_t scale = 0;
+            for (size_t i = 0; i < keyCounts.size(); i += 3)
+            {
+                if (color + keyCounts[i] > colors.size() || alpha + keyCounts[i + 1] > alphas.size() ||
+                    scale + keyCounts[i + 2] > scales.size())
+                {
+                    return false;
+                }
+
+                LifetimeCurves curves;
+                curves.colors.assign(colors.begin() + color, colors.begin() + color + keyCounts[i]);
+                curves.alphas.assign(alphas.begin() + alpha, alphas.begin() + alpha + keyCounts[i + 1]);
+                curves.scales.assign(scales.begin() + scale, scales.begin() + scale + keyCounts[i + 2]);
+                color += keyCounts[i];
+                alpha += keyCounts[i + 1];
+                scale += keyCounts[i + 2];
+                if (library.Intern(curves) != i / 3 + 1)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename Function>
+        void ForEachArray(Function &&function)
+        {
+            function(keyCounts);
+            function(colors);
+            function(alphas);
+            function(scales);
+        }
+    };
+
+    // Every array of the snapshot, in the order of the file
+    template <typename Particles, typename Emitters, typename Palettes, typename Function>
+    void ForEachSnapshotArray(Particles &particles, Emitters &emitters, CurveArrays &curves, Palettes &palettes,
+                              Function &&function)
+    {
+        particles.ForEachArray(function);
+        emitters.ForEachArray(function);
+        curves.ForEachArray(function);
+        function(palettes);
+    }
+
+    // Read-only view of the whole file: mapped where possible, read into memory otherwise
+    class FileView
+    {
+    public:
+        explicit FileView(const std::string &path)
+        {
+#ifdef PARTICLES_SNAPSHOT_MMAP
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return;
+            }
+            struct stat info{};
+            if (fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping != MAP_FAILED)
+                {
+                    // Read once from the start to the end
+                    madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                    _data = static_cast<const unsigned char *>(mapping);
+                    _size = static_cast<size_t>(info.st_size);
+                }
+            }
+            close(fd);
+#else
+            std::FILE *file = std::fopen(path.c_str(), "rb");
+            if (!file)
+            {
+                return;
+            }
+            if (std::fseek(file, 0, SEEK_END) == 0)
+            {
+                const long size = std::ftell(file);
+                std::rewind(file);
+                _buffer.resize(size > 0 ? static_cast<size_t>(size) : 0);
+                if (std::fread(_buffer.data(), 1, _buffer.size(), file) == _buffer.size())
+                {
+                    _data = _buffer.data();
+                    _size = _buffer.size();
+                }
+            }
+            std::fclose(file);
+#endif
+        }
+
+        ~FileView()
+        {
+#ifdef PARTICLES_SNAPSHOT_MMAP
+            if (_data)
+            {
+                munmap(const_cast<unsigned char *>(_data), _size);
+            }
+#endif
+        }
+
+        FileView(const FileView &) = delete;
+        FileView &operator=(const FileView &) = delete;
+
+        const unsigned char *GetData() const { return _data; }
+        size_t GetSize() const { return _size; }
+
+    private:
+        const unsigned char *_data = nullptr;
+        size_t _size = 0;
+#ifndef PARTICLES_SNAPSHOT_MMAP
+        std::vector<unsigned char> _buffer;
+#endif
+    };
+} // namespace
+
+bool ParticleSnapshot::Save(const ParticleSystem &system, const std::string &path)
+{
+    CurveArrays curves(&system._curves);
+    const std::vector<ParticleStorage::Palette> palettes{system._particles.palette};
+
+    // Lay the arrays out after the header and the table
+    std::vector<ArrayEntry> entries;
+    std::vector<const void *> sources;
+    std::uint64_t offset = 0;
+    ForEachSnapshotArray(system._particles, system._emitters, curves, palettes,
+                         [&](const auto &array)
+                         {
+                             ArrayEntry entry;
+                             entry.count = array.size();
+                             entry.elementSize = ElementSize<decltype(array)>();
+                             entries.push_back(entry);
+                             sources.push_back(array.data());
+                         });
+    offset = AlignUp(sizeof(FileHeader) + entries.size() * sizeof(ArrayEntry));
+    for (ArrayEntry &entry : entries)
+    {
+        entry.offset = offset;
+        offset = AlignUp(offset + entry.count * entry.elementSize);
+    }
+
+    FileHeader header;
+    header.storage = STORAGE;
+    header.arrayCount = static_cast<std::uint32_t>(entries.size());
+    header.fileSize = offset;
+    header.steps = system._steps;
+    header.time = system._time;
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(entries.data(), sizeof(ArrayEntry), entries.size(), file) == entries.size();
+    std::uint64_t written = sizeof(header) + entries.size() * sizeof(ArrayEntry);
+    static const unsigned char padding[ALIGNMENT] = {};
+    for (size_t i = 0; ok && i < entries.size(); ++i)
+    {
+        const size_t bytes = entries[i].count * entries[i].elementSize;
+        ok = std::fwrite(padding, 1, entries[i].offset - written, file) == entries[i].offset - written &&
+             std::fwrite(sources[i], 1, bytes, file) == bytes;
+        written = entries[i].offset + bytes;
+    }
+    ok = ok && std::fwrite(padding, 1, header.fileSize - written, file) == header.fileSize - written;
+
+    return std::fclose(file) == 0 && ok;
+}
+
+bool ParticleSnapshot::Load(ParticleSystem &system, const std::string &path)
+{
+    const FileView file(path);
+    const unsigned char *data = file.GetData();
+    if (!data || file.GetSize() < sizeof(FileHeader))
+    {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.storage != STORAGE ||
+        header.fileSize != file.GetSize() ||
+        sizeof(FileHeader) + std::uint64_t{header.arrayCount} * sizeof(ArrayEntry) > file.GetSize())
+    {
+        return false;
+    }
+    std::vector<ArrayEntry> entries(header.arrayCount);
+    std::memcpy(entries.data(), data + sizeof(FileHeader), entries.size() * sizeof(ArrayEntry));
+
+    // Check the whole table against the arrays of this build before changing anything
+    CurveArrays curves;
+    std::vector<ParticleStorage::Palette> palettes;
+    size_t index = 0;
+    bool valid = true;
+    ForEachSnapshotArray(system._particles, system._emitters, curves, palettes,
+                         [&](const auto &array)
+                         {
+                             if (index >= entries.size())
+                             {
+                                 valid = false;
+                                 return;
+                             }
+                             const ArrayEntry &entry = entries[index++];
+                             const std::uint32_t elementSize = ElementSize<decltype(array)>();
+                             valid = valid && entry.elementSize == elementSize && entry.offset % ALIGNMENT == 0 &&
+                                     entry.count <= (file.GetSize() - std::min<std::uint64_t>(entry.offset,
+                                                                                              file.GetSize())) /
+                                                            elementSize;
+                         });
+    if (!valid || index != entries.size())
+    {
+        return false;
+    }
+
+    // The arrays of the particle SoA, then the ones of the emitter table (all but the slot lists), are parallel
+    size_t particleArrays = 0;
+    size_t curveIdsArray = 0;
+    system._particles.ForEachArray(
+            [&](const auto &array)
+            {
+                if (static_cast<const void *>(&array) == &system._particles.curveIds)
+                {
+                    curveIdsArray = particleArrays;
+                }
+                ++particleArrays;
+            });
+    size_t emitterArrays = 0;
+    system._emitters.ForEachArray([&emitterArrays](const auto &) { ++emitterArrays; });
+    const auto parallel = [&entries](const size_t begin, const size_t end)
+    {
+        return std::all_of(entries.begin() + begin, entries.begin() + end,
+                           [&](const ArrayEntry &entry) { return entry.count == entries[begin].count; });
+    };
+    if (!parallel(0, particleArrays) || !parallel(particleArrays, particleArrays + emitterArrays - 2))
+    {
+        return false;
+    }
+
+    // Beyond the capacity, only OverflowPolicy::Grow keeps all the particles, the others keep the first ones
+    std::uint64_t particleCount = entries.front().count;
+    if (system._overflowPolicy != OverflowPolicy::Grow)
+    {
+        particleCount = std::min<std::uint64_t>(particleCount, system._capacity);
+    }
+
+    // One block copy per array, of at most limit elements
+    index = 0;
+    std::uint64_t limit = particleCount;
+    const auto copy = [&](auto &array)
+    {
+        // assign rather than resize and copy, which would write the new elements twice. The offsets are aligned, the
+        // mapping is page aligned, so the elements are properly aligned in place.
+        using Element = typename std::decay_t<decltype(array)>::value_type;
+        const auto *first = reinterpret_cast<const Element *>(data + entries[index].offset);
+        array.assign(first, first + std::min(entries[index++].count, limit));
+    };
+
+    // Everything but the particles is read and checked first, the file can still be rejected. The curves and the
+    // palette, the last arrays of the file: the library is rebuilt from its descriptions, which gives the curves
+    // back their id.
+    limit = std::numeric_limits<std::uint64_t>::max();
+    index = entries.size() - (CurveArrays::ARRAY_COUNT + 1);
+    curves.ForEachArray(copy);
+    copy(palettes);
+    CurveLibrary library;
+    if (palettes.size() != 1 || !curves.Restore(library))
+    {
+        return false;
+    }
+
+    // The emitters, into a pool of their own until their slots are checked
+    EmitterPool emitters;
+    index = particleArrays;
+    emitters.ForEachArray(copy);
+    if (!emitters.IsConsistent(library.GetSize()))
+    {
+        return false;
+    }
+
+    // The curve ids of the particles, in place
+    const auto *curveIds = reinterpret_cast<const std::uint16_t *>(data + entries[curveIdsArray].offset);
+    if (std::any_of(curveIds, curveIds + particleCount,
+                    [&library](const std::uint16_t id) { return id >= library.GetSize(); }))
+    {
+        return false;
+    }
+
+    index = 0;
+    limit = particleCount;
+    system._particles.ForEachArray(copy);
+    system._emitters = std::move(emitters);
+    system._curves = std::move(library);
+    system._particles.palette = palettes.front();
+    system._steps = header.steps;
+    system._time = header.time;
+    system._accumulator = sf::Time::Zero;
+    system._verticesWritten = 0;
+    system._collisionKills = 0;
+    system._spatialGridStale = true;
+    return true;
+}
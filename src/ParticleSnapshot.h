@@ -0,0 +1,48 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef PARTICLESNAPSHOT_H
+#define PARTICLESNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+
+// Forward Declaration
+class ParticleSystem;
+
+/**
+ * Binary snapshot of the state of a ParticleSystem: every array of the particle SoA, of the emitter pool, the lifetime
+ * curves and the color palette, the simulated time and the step count. Used to warm-start heavy scenes, to capture a
+ * frame to investigate, and as fixtures for the benchmark (particles_bench --snapshot).
+ *
+ * The file is a header, a table of arrays (offset, count, element size), then the arrays themselves, each aligned on
+ * ALIGNMENT bytes and stored as in memory, in the byte order of the machine. Loading maps the file and copies every
+ * array into the system in one block, without any per element parsing; the table is checked against the element
+ * sizes of this build first, so a file of another version or storage policy (PARTICLES_COMPACT_STORAGE) is
+ * rejected without touching the system.
+ *
+ * The configuration of the system (boundaries, capacity, policies, affectors, surfaces, threads) isn't part of the
+ * snapshot, the loaded state runs with the configuration of the system it's loaded into: past its capacity, only
+ * OverflowPolicy::Grow loads every particle, the other policies keep the first ones.
+ *
+ * ```
+ * ParticleSnapshot::Save(system, "scene.psnp");
+ * ParticleSnapshot::Load(otherSystem, "scene.psnp");
+ * ```
+ */
+class ParticleSnapshot
+{
+public:
+    static constexpr std::uint32_t VERSION = 1;
+    // Alignment of the arrays in the file, a cache line. The mapping of the file is page aligned, so the arrays
+    // keep it in memory.
+    static constexpr std::uint64_t ALIGNMENT = 64;
+
+    // Returns false if the file couldn't be written
+    static bool Save(const ParticleSystem &system, const std::string &path);
+    // Replace the state of system by the one of the file, returns false (and leaves system untouched) if the file
+    // can't be read, doesn't match this build or is inconsistent (curve ids, emitter slots)
+    static bool Load(ParticleSystem &system, const std::string &path);
+};
+
+#endif
@@ -0,0 +1,102 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "ParticleStats.h"
+
+#include <algorithm>
+
+#ifndef PARTICLES_NO_STATS
+void ParticleStats::NextFrame()
+{
+    const Clock::time_point now = Clock::now();
+    _current[Index(StatStage::Frame)] = std::chrono::duration<double, std::nano>(now - _frameStart).count();
+    _frameStart = now;
+
+    const size_t slot = _frames % WINDOW_SIZE;
+    for (size_t stage = 0; stage < STAGE_COUNT; ++stage)
+    {
+        _window[stage][slot] = _current[stage];
+    }
+    _current.fill(0.0);
+
+    for (size_t counter = 0; counter < COUNTER_COUNT; ++counter)
+    {
+        _lastCounters[counter] = _counters[counter];
+        _totalCounters[counter] += _counters[counter];
+    }
+    _counters.fill(0);
+    ++_frames;
+}
+
+StageSummary ParticleStats::GetSummary(const StatStage stage) const
+{
+    const size_t count = static_cast<size_t>(std::min<unsigned long long>(_frames, WINDOW_SIZE));
+    if (count == 0)
+    {
+        return {};
+    }
+
+    const std::array<double, WINDOW_SIZE> &window = _window[Index(stage)];
+    std::array<double, WINDOW_SIZE> sorted{};
+    std::copy(window.begin(), window.begin() + count, sorted.begin());
+    std::sort(sorted.begin(), sorted.begin() + count);
+
+    // Nearest rank
+    const auto percentile = [&](const double p)
+    { return sorted[std::min(count - 1, static_cast<size_t>(p * static_cast<double>(count)))]; };
+
+    StageSummary summary;
+    summary.last = window[(_frames - 1) % WINDOW_SIZE];
+    for (size_t i = 0; i < count; ++i)
+    {
+        summary.mean += sorted[i];
+    }
+    summary.mean /= static_cast<double>(count);
+    summary.p50 = percentile(.50);
+    summary.p95 = percentile(.95);
+    summary.p99 = percentile(.99);
+    summary.max = sorted[count - 1];
+    return summary;
+}
+#endif
+
+const char *ParticleStats::GetName(const StatStage stage)
+{
+    switch (stage)
+    {
+        case StatStage::Kill:
+            return "kill";
+        case StatStage::Grid:
+            return "grid";
+        case StatStage::Affect:
+            return "affect";
+        case StatStage::Collide:
+            return "collide";
+        case StatStage::Integrate:
+            return "integrate";
+        case StatStage::Emit:
+            return "emit";
+        case StatStage::VertexBuild:
+            return "vertex";
+        case StatStage::Render:
+            return "render";
+        case StatStage::Frame:
+        default:
+            return "frame";
+    }
+}
+
+const char *ParticleStats::GetName(const StatCounter counter)
+{
+    switch (counter)
+    {
+        case StatCounter::Spawned:
+            return "spawned";
+        case StatCounter::KilledExpired:
+            return "expired";
+        case StatCounter::KilledOutOfBounds:
+            return "out of bounds";
+        case StatCounter::Reallocations:
+        default:
+            return "reallocations";
+    }
+}
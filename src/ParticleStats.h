@@ -0,0 +1,175 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef PARTICLESTATS_H
+#define PARTICLESTATS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <type_traits>
+
+// Timed sections of a frame
+enum class StatStage
+{
+    Kill,
+    Grid,
+    Affect,
+    Collide,
+    Integrate,
+    Emit,
+    // ParticleRenderer::Update
+    VertexBuild,
+    // ParticleRenderer::Render, the upload and the draw call on the CPU side
+    Render,
+    // Wall time between two frames of the system (see ParticleStats::NextFrame)
+    Frame,
+    Count
+};
+
+// Events counted per frame
+enum class StatCounter
+{
+    Spawned,
+    KilledExpired,
+    // Out of the screen, or stopped by a CollisionResponse::Kill surface
+    KilledOutOfBounds,
+    // Spawns that made the particle arrays grow past their capacity (OverflowPolicy::Grow)
+    Reallocations,
+    Count
+};
+
+// Rolling summary of a stage over the last ParticleStats::WINDOW_SIZE frames, in nanoseconds
+struct StageSummary
+{
+    double last = 0.0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * Timings and counters of the particle system, per frame. The stages add their time to the current frame with a
+ * ScopedStageTimer (PARTICLES_STAT_SCOPE), and NextFrame closes it: its times and counters go into a ring of the
+ * last WINDOW_SIZE frames the percentiles are computed from. A stage that runs several times in a frame (the fixed
+ * steps of ParticleSystem::Advance) is summed over the frame.
+ *
+ * Built with PARTICLES_STATS off (PARTICLES_NO_STATS defined), ENABLED is false: the class is empty, the macros expand
+ * to nothing, the system skips its counting passes, NextFrame does nothing and every value reads 0.
+ *
+ * ```
+ * {
+ *     PARTICLES_STAT_SCOPE(stats, StatStage::Integrate);
+ *     ...
+ * }
+ * stats.NextFrame();
+ * const StageSummary integrate = stats.GetSummary(StatStage::Integrate);
+ * ```
+ */
+class ParticleStats
+{
+public:
+#ifdef PARTICLES_NO_STATS
+    static constexpr bool ENABLED = false;
+#else
+    static constexpr bool ENABLED = true;
+#endif
+    // Frames the percentiles are computed over, a bit more than a second at 144 FPS
+    static constexpr size_t WINDOW_SIZE = 256;
+
+    using Clock = std::chrono::steady_clock;
+
+#ifdef PARTICLES_NO_STATS
+    void AddTime(StatStage, double) {}
+    void Add(StatCounter, unsigned long long) {}
+    void NextFrame() {}
+    StageSummary GetSummary(StatStage) const { return {}; }
+    unsigned long long GetLast(StatCounter) const { return 0; }
+    unsigned long long GetTotal(StatCounter) const { return 0; }
+    unsigned long long GetFrameCount() const { return 0; }
+#else
+    void AddTime(StatStage stage, double ns) { _current[Index(stage)] += ns; }
+    void Add(StatCounter counter, unsigned long long count) { _counters[Index(counter)] += count; }
+
+    // Close the current frame and start the next one
+    void NextFrame();
+
+    // Over the last WINDOW_SIZE frames (fewer until that many were recorded). The percentiles sort a copy of the
+    // window, query them once per displayed frame at most.
+    StageSummary GetSummary(StatStage stage) const;
+    // Value of the counter in the last closed frame and since the start
+    unsigned long long GetLast(StatCounter counter) const { return _lastCounters[Index(counter)]; }
+    unsigned long long GetTotal(StatCounter counter) const { return _totalCounters[Index(counter)]; }
+    // Number of closed frames
+    unsigned long long GetFrameCount() const { return _frames; }
+#endif
+
+    static const char *GetName(StatStage stage);
+    static const char *GetName(StatCounter counter);
+
+#ifndef PARTICLES_NO_STATS
+private:
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(StatStage::Count);
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(StatCounter::Count);
+
+    // Times of the open frame
+    std::array<double, STAGE_COUNT> _current{};
+    // Ring of the closed frames, per stage
+    std::array<std::array<double, WINDOW_SIZE>, STAGE_COUNT> _window{};
+    unsigned long long _frames = 0;
+    Clock::time_point _frameStart = Clock::now();
+
+    std::array<unsigned long long, COUNTER_COUNT> _counters{};
+    std::array<unsigned long long, COUNTER_COUNT> _lastCounters{};
+    std::array<unsigned long long, COUNTER_COUNT> _totalCounters{};
+
+    template <class Enum>
+    static size_t Index(const Enum value)
+    {
+        return static_cast<size_t>(value);
+    }
+#endif
+};
+
+#ifdef PARTICLES_NO_STATS
+static_assert(std::is_empty_v<ParticleStats>, "ParticleStats must cost nothing without PARTICLES_STATS");
+#endif
+
+// Adds the time of its scope to a stage of the current frame
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(ParticleStats &stats, const StatStage stage)
+        : _stats(stats)
+        , _stage(stage)
+        , _start(ParticleStats::Clock::now())
+    {
+    }
+    ~ScopedStageTimer()
+    {
+        _stats.AddTime(_stage, std::chrono::duration<double, std::nano>(ParticleStats::Clock::now() - _start).count());
+    }
+
+    ScopedStageTimer(const ScopedStageTimer &) = delete;
+    ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+private:
+    ParticleStats &_stats;
+    StatStage _stage;
+    ParticleStats::Clock::time_point _start;
+};
+
+#ifdef PARTICLES_NO_STATS
+#define PARTICLES_STAT_SCOPE(stats, stage)
+#define PARTICLES_STAT_ADD(stats, counter, count)
+#else
+#define PARTICLES_STAT_CONCAT_INNER(a, b) a##b
+#define PARTICLES_STAT_CONCAT(a, b) PARTICLES_STAT_CONCAT_INNER(a, b)
+#define PARTICLES_STAT_SCOPE(stats, stage) \
+    const ScopedStageTimer PARTICLES_STAT_CONCAT(statTimer, __LINE__)((stats), (stage))
+#define PARTICLES_STAT_ADD(stats, counter, count) (stats).Add((counter), (count))
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef PARTICLESTORAGE_H
+#define PARTICLESTORAGE_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "ParticleColor.h"
+
+/**
+ * Storage policies of the Particles SoA, selected at compile time with the PARTICLES_COMPACT_STORAGE CMake option.
+ * A policy gives the type stored for the velocity, the color and the lifetime of a particle, and how to convert them
+ * from and to what the simulation works with (sf::Vector2f, ParticleColor, seconds).
+ *
+ * - FullStorage stores them as is (8 bytes of velocity, 4 of color, 8 of lifetime and time remainder)
+ * - CompactStorage stores the velocity as two 16 bits fixed point values, the color as an index in a palette of
+ *   256 colors, the lifetime as a 16 bits float and the time remainder as the normalized fraction of the lifetime
+ *   left in 16 bits (4 bytes of velocity, 1 of color, 4 of lifetime and time remainder). The stages decode the
+ *   values of a block into floats on the stack and encode them back, see ForEachVelocityBlock and ForEachTimeBlock.
+ *
+ * The stages are memory bound: the compact storage reads and moves less memory per particle (integrate, affectors,
+ * collisions, kill compaction) for a little more arithmetic.
+ */
+
+// Full precision storage, the simulation works directly on the arrays
+struct FullStorage
+{
+    using Velocity = sf::Vector2f;
+    using Color = ParticleColor;
+
+    // Nothing to store, the colors are their own value
+    struct Palette
+    {
+        Color Encode(const ParticleColor color) { return color; }
+        ParticleColor Decode(const Color color) const { return color; }
+    };
+
+    static Velocity EncodeVelocity(const sf::Vector2f velocity) { return velocity; }
+    static sf::Vector2f DecodeVelocity(const Velocity velocity) { return velocity; }
+
+    // Seconds, the time remainder counts down to 0
+    using LifeTime = float;
+    using TimeRemainder = float;
+
+    static LifeTime EncodeLifeTime(const float lifeTime) { return lifeTime; }
+    static float DecodeLifeTime(const LifeTime lifeTime) { return lifeTime; }
+    static TimeRemainder EncodeTimeRemainder(const float timeRemainder, float) { return timeRemainder; }
+    static float DecodeTimeRemainder(const TimeRemainder timeRemainder, float) { return timeRemainder; }
+    static bool HasExpired(const TimeRemainder timeRemainder) { return timeRemainder <= 0.f; }
+};
+
+// Velocity in 1 / VELOCITY_STEPS px/s, saturated to +-MAX_VELOCITY px/s
+struct PackedVelocity
+{
+    std::int16_t x = 0;
+    std::int16_t y = 0;
+};
+
+// Small storage: 16 bits fixed point velocities and palette indices
+struct CompactStorage
+{
+    using Velocity = PackedVelocity;
+    using Color = std::uint8_t;
+
+    // Steps per px/s: the precision is 0.0625 px/s. A change of the velocity smaller than half a step in one stage
+    // is lost (a weak drag on a slow particle, for instance).
+    static constexpr float VELOCITY_STEPS = 16.f;
+    static constexpr float MAX_VELOCITY = 32767.f / VELOCITY_STEPS;
+    // Velocities decoded at once by ForEachVelocityBlock (8 KB on the stack), time remainders by ForEachTimeBlock
+    static constexpr size_t BLOCK_SIZE = 1024;
+
+    // The colors the particles were spawned with. Past 256 colors, a new color gets the closest one of the palette.
+    class Palette
+    {
+    public:
+        Color Encode(ParticleColor color);
+        ParticleColor Decode(const Color color) const { return _colors[color]; }
+
+    private:
+        std::array<ParticleColor, 256> _colors{};
+        size_t _size = 0;
+    };
+
+    static std::int16_t EncodeComponent(float value);
+    static Velocity EncodeVelocity(const sf::Vector2f velocity)
+    {
+        return {EncodeComponent(velocity.x), EncodeComponent(velocity.y)};
+    }
+    static sf::Vector2f DecodeVelocity(const Velocity velocity)
+    {
+        return {velocity.x / VELOCITY_STEPS, velocity.y / VELOCITY_STEPS};
+    }
+
+    // The lifetime is a half float (11 bits of precision, from MIN_LIFETIME to MAX_LIFETIME seconds, 0 below). The
+    // time remainder is the fraction of the lifetime left in 1 / TIME_STEPS: TIME_STEPS at birth, 0 once expired.
+    using LifeTime = std::uint16_t;
+    using TimeRemainder = std::uint16_t;
+
+    static constexpr float MIN_LIFETIME = 1.f / 16384.f;
+    static constexpr float MAX_LIFETIME = 65504.f;
+    static constexpr std::uint16_t TIME_STEPS = 65535;
+
+    static LifeTime EncodeLifeTime(float lifeTime);
+    static float DecodeLifeTime(LifeTime lifeTime);
+    static TimeRemainder EncodeTimeRemainder(float timeRemainder, float lifeTime);
+    static float DecodeTimeRemainder(const TimeRemainder timeRemainder, const float lifeTime)
+    {
+        return static_cast<float>(timeRemainder) * (lifeTime * (1.f / TIME_STEPS));
+    }
+    static bool HasExpired(const TimeRemainder timeRemainder) { return timeRemainder == 0; }
+    // The time remainder once a stage changed its decoded seconds to seconds (see ForEachTimeBlock)
+    static TimeRemainder UpdateTimeRemainder(TimeRemainder timeRemainder, float lifeTime, float seconds,
+                                             float roundingOffset);
+};
+
+inline CompactStorage::Color CompactStorage::Palette::Encode(const ParticleColor color)
+{
+    for (size_t i = 0; i < _size; ++i)
+    {
+        if (_colors[i] == color)
+        {
+            return static_cast<Color>(i);
+        }
+    }
+    if (_size < _colors.size())
+    {
+        _colors[_size] = color;
+        return static_cast<Color>(_size++);
+    }
+
+    // Full, the closest color
+    size_t closest = 0;
+    int closestDistance = std::numeric_limits<int>::max();
+    for (size_t i = 0; i < _size; ++i)
+    {
+        const int r = _colors[i].r - color.r;
+        const int g = _colors[i].g - color.g;
+        const int b = _colors[i].b - color.b;
+        const int a = _colors[i].a - color.a;
+        const int distance = r * r + g * g + b * b + a * a;
+        if (distance < closestDistance)
+        {
+            closest = i;
+            closestDistance = distance;
+        }
+    }
+    return static_cast<Color>(closest);
+}
+
+inline std::int16_t CompactStorage::EncodeComponent(const float value)
+{
+    // Rounded to the nearest step then saturated. Written as selects, without std::clamp, so the loops vectorize:
+    // GCC turned the clamp before the rounding into branches.
+    float steps = value * VELOCITY_STEPS;
+    steps += steps < 0.f ? -.5f : .5f;
+    steps = steps < 32767.f ? steps : 32767.f;
+    steps = steps > -32767.f ? steps : -32767.f;
+    return static_cast<std::int16_t>(static_cast<std::int32_t>(steps));
+}
+
+inline CompactStorage::LifeTime CompactStorage::EncodeLifeTime(const float lifeTime)
+{
+    // Written so a NaN ends up at 0 too
+    if (!(lifeTime >= MIN_LIFETIME))
+    {
+        return 0;
+    }
+
+    // Round the mantissa to 10 bits, a carry goes into the exponent, then rebias the exponent from 127 to 15
+    std::uint32_t bits;
+    const float clamped = std::min(lifeTime, MAX_LIFETIME);
+    std::memcpy(&bits, &clamped, sizeof(bits));
+    bits += 1u << 12;
+    return static_cast<LifeTime>((bits >> 13) - ((127u - 15u) << 10));
+}
+
+inline float CompactStorage::DecodeLifeTime(const LifeTime lifeTime)
+{
+    // Rebias the exponent back, the 0 masked without a branch so the loops vectorize
+    const std::uint32_t mask = lifeTime != 0 ? ~0u : 0u;
+    const std::uint32_t bits = ((static_cast<std::uint32_t>(lifeTime) << 13) + ((127u - 15u) << 23)) & mask;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline CompactStorage::TimeRemainder CompactStorage::EncodeTimeRemainder(const float timeRemainder,
+                                                                         const float lifeTime)
+{
+    // Written so a NaN (zero lifetime) ends up at 0
+    const float fraction = timeRemainder / lifeTime;
+    if (!(fraction > 0.f))
+    {
+        return 0;
+    }
+    return static_cast<TimeRemainder>(std::min(fraction, 1.f) * TIME_STEPS + .5f);
+}
+
+inline CompactStorage::TimeRemainder CompactStorage::UpdateTimeRemainder(const TimeRemainder timeRemainder,
+                                                                         const float lifeTime, const float seconds,
+                                                                         const float roundingOffset)
+{
+    // The new value in steps, rounded up or down depending on the offset: a decrease smaller than a step still adds
+    // up over the frames. Never above the old value, so unchanged seconds keep it, and 0 once expired. Written as
+    // selects so the loops vectorize (a NaN from a zero lifetime ends up at 0).
+    float steps = seconds / lifeTime * TIME_STEPS - roundingOffset + 1.f;
+    steps = steps < static_cast<float>(timeRemainder) ? steps : static_cast<float>(timeRemainder);
+    steps = seconds > 0.f ? steps : 0.f;
+    steps = steps > 0.f ? steps : 0.f;
+    return static_cast<TimeRemainder>(static_cast<std::int32_t>(steps));
+}
+
+#ifdef PARTICLES_COMPACT_STORAGE
+using ParticleStorage = CompactStorage;
+#else
+using ParticleStorage = FullStorage;
+#endif
+
+/**
+ * Call function(velocities, offset, n) over the count velocities of the storage, with velocities the floats of the
+ * particles [offset, offset + n). The full storage passes its own array in a single call. The compact one decodes
+ * blocks of CompactStorage::BLOCK_SIZE, and encodes them back after the call when Write is set.
+ */
+template <bool Write, class Velocity, class Function>
+void ForEachVelocityBlock(Velocity *velocities, const size_t count, Function &&function)
+{
+    if constexpr (std::is_same_v<std::remove_const_t<Velocity>, sf::Vector2f>)
+    {
+        function(velocities, size_t{0}, count);
+    }
+    else
+    {
+        sf::Vector2f decoded[CompactStorage::BLOCK_SIZE];
+        for (size_t block = 0; block < count; block += CompactStorage::BLOCK_SIZE)
+        {
+            const size_t n = std::min(CompactStorage::BLOCK_SIZE, count - block);
+            for (size_t i = 0; i < n; ++i)
+            {
+                decoded[i] = CompactStorage::DecodeVelocity(velocities[block + i]);
+            }
+            function(decoded, block, n);
+            if constexpr (Write)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    velocities[block + i] = CompactStorage::EncodeVelocity(decoded[i]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Call function(timeRemainder, offset, n) over the count time remainders of the storage, with timeRemainder the
+ * seconds left of the particles [offset, offset + n), 0 or less once expired. The full storage passes its own array in
+ * a single call. The compact one decodes blocks of CompactStorage::BLOCK_SIZE, and stores the changes back after the
+ * call when Write is set (see CompactStorage::UpdateTimeRemainder, roundingOffset in [0, 1) should change every
+ * frame).
+ */
+template <bool Write, class TimeRemainder, class LifeTime, class Function>
+void ForEachTimeBlock(TimeRemainder *timeRemainder, const LifeTime *lifeTimes, const size_t count,
+                      const float roundingOffset, Function &&function)
+{
+    if constexpr (std::is_same_v<std::remove_const_t<TimeRemainder>, float>)
+    {
+        function(timeRemainder, size_t{0}, count);
+    }
+    else
+    {
+        // The lifetimes are decoded once for both directions
+        float decodedLifeTimes[CompactStorage::BLOCK_SIZE];
+        float decoded[CompactStorage::BLOCK_SIZE];
+        for (size_t block = 0; block < count; block += CompactStorage::BLOCK_SIZE)
+        {
+            const size_t n = std::min(CompactStorage::BLOCK_SIZE, count - block);
+            for (size_t i = 0; i < n; ++i)
+            {
+                decodedLifeTimes[i] = CompactStorage::DecodeLifeTime(lifeTimes[block + i]);
+                decoded[i] = CompactStorage::DecodeTimeRemainder(timeRemainder[block + i], decodedLifeTimes[i]);
+            }
+            function(decoded, block, n);
+            if constexpr (Write)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    timeRemainder[block + i] = CompactStorage::UpdateTimeRemainder(
+                            timeRemainder[block + i], decodedLifeTimes[i], decoded[i], roundingOffset);
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -1,53 +1,281 @@
 // Copyright (c) 2025 Eric Jeker. All rights reserved.
 
-#include <SFML/Graphics/RectangleShape.hpp>
-#include <random>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
 
-#include "ParticleEmitter.h"
 #include "ParticleSystem.h"
+#include "SceneRecording.h"
+#include "SimdKernels.h"
+#include "Tracer.h"
+
+// The SIMD kernels see the sf::Vector2f arrays as interleaved x, y floats
+static_assert(sizeof(sf::Vector2f) == 2 * sizeof(float), "sf::Vector2f must be two packed floats");
+
+namespace
+{
+    // Particles integrated before their vertices are written when the vertex build is fused, small enough for the
+    // block to still be in L1 when it's copied to the vertices
+    constexpr size_t FUSED_BLOCK_SIZE = 1024;
+
+    // Emitters allocated up front, the pool only grows past this
+    constexpr size_t RESERVED_EMITTERS = 1024;
+
+    // Recycling frees at least capacity / RECYCLE_HEADROOM_DIVISOR particles at once
+    constexpr size_t RECYCLE_HEADROOM_DIVISOR = 16;
+    // Resolution of the histogram used to pick the particles to recycle
+    constexpr size_t RECYCLE_BUCKETS = 1024;
+
+    // Move the elements flagged in aliveMask to the front of the array, keeping their order, and drop the rest.
+    // Everything before firstDead is already in place and is skipped.
+    template <typename T>
+    void CompactArrayStable(std::vector<T> &array, const std::vector<unsigned char> &aliveMask, const size_t firstDead)
+    {
+        size_t write = firstDead;
+        for (size_t read = firstDead; read < array.size(); ++read)
+        {
+            if (aliveMask[read])
+            {
+                array[write++] = array[read];
+            }
+        }
+        array.resize(write);
+    }
+
+    // Replay the moves computed by the kill pass and drop the tail
+    template <typename T>
+    void CompactArray(std::vector<T> &array, const std::vector<size_t> &moveFrom, const std::vector<size_t> &moveTo,
+                      const size_t newSize)
+    {
+        for (size_t k = 0; k < moveFrom.size(); ++k)
+        {
+            array[moveTo[k]] = array[moveFrom[k]];
+        }
+        array.resize(newSize);
+    }
+
+    // Rounding offset of the compact time remainders (see ForEachTimeBlock), in [0, 1): a hash of the simulated time,
+    // so it changes every step and a snapshot restores it
+    float TimeRoundingOffset(const float time)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &time, sizeof(bits));
+        return static_cast<float>((bits * 2654435769u) >> 8) / static_cast<float>(1u << 24);
+    }
+} // namespace
 
 ParticleSystem::ParticleSystem(const unsigned screenWidth, const unsigned screenHeight)
     : _screenWidth(screenWidth)
     , _screenHeight(screenHeight)
+    , _collisionSurfaces(static_cast<float>(screenWidth), static_cast<float>(screenHeight))
 {
 }
 
 void ParticleSystem::Initialize(const unsigned nbrParticles)
 {
-    // Shapes vector
-    _vertices = sf::VertexArray(sf::PrimitiveType::Points);
+    _capacity = nbrParticles;
+    _emitters.Reserve(RESERVED_EMITTERS);
 
     // Particle data
-    _particles.positions.reserve(nbrParticles);
-    _particles.velocities.reserve(nbrParticles);
-    _particles.scales.reserve(nbrParticles);
-    _particles.colors.reserve(nbrParticles);
-    _particles.lifeTimes.reserve(nbrParticles);
-    _particles.timeRemainder.reserve(nbrParticles);
+    _particles.ForEachArray([nbrParticles](auto &array) { array.reserve(nbrParticles); });
+
+    // Scratch buffers of the update stages
+    _aliveMask.reserve(nbrParticles);
+    _moveFrom.reserve(nbrParticles);
+    _moveTo.reserve(nbrParticles);
+    _recycleKeys.reserve(nbrParticles);
+    if (_fusedVertexBuild)
+    {
+        _vertices.reserve(nbrParticles);
+    }
+}
+
+void ParticleSystem::SetOverflowPolicy(const OverflowPolicy policy) { _overflowPolicy = policy; }
+OverflowPolicy ParticleSystem::GetOverflowPolicy() const { return _overflowPolicy; }
+size_t ParticleSystem::GetCapacity() const { return _capacity; }
+unsigned long long ParticleSystem::GetDroppedSpawns() const { return _droppedSpawns; }
+unsigned long long ParticleSystem::GetRecycledParticles() const { return _recycledParticles; }
+
+void ParticleSystem::SetKillMode(const KillMode mode) { _killMode = mode; }
+KillMode ParticleSystem::GetKillMode() const { return _killMode; }
+unsigned ParticleSystem::GetScreenWidth() const { return _screenWidth; }
+unsigned ParticleSystem::GetScreenHeight() const { return _screenHeight; }
+
+void ParticleSystem::SetThreadCount(const unsigned threadCount)
+{
+    _jobs = std::make_unique<JobSystem>(threadCount);
+    if (_jobs->GetThreadCount() == 1)
+    {
+        _jobs.reset();
+    }
+}
+
+JobSystem *ParticleSystem::GetJobSystem() const { return _jobs.get(); }
+
+void ParticleSystem::SetFusedVertexBuild(const bool enabled)
+{
+    _fusedVertexBuild = enabled;
+    _verticesWritten = 0;
+    if (enabled)
+    {
+        _vertices.reserve(_capacity);
+    }
+    else
+    {
+        _vertices.clear();
+        _vertices.shrink_to_fit();
+    }
+}
+
+bool ParticleSystem::IsFusedVertexBuild() const { return _fusedVertexBuild; }
+
+const std::vector<ParticleVertex> &ParticleSystem::GetVertices() const { return _vertices; }
+
+void ParticleSystem::WriteVertices(const size_t begin, const size_t end)
+{
+    _vertices.resize(_particles.positions.size());
+    _curves.WriteVertices(_particles, begin, end, _vertices.data());
+    _verticesWritten = end;
+}
+
+void ParticleSystem::ForEachChunk(const size_t count, const std::function<void(size_t, size_t)> &function) const
+{
+    if (_jobs)
+    {
+        _jobs->ParallelFor(count, JobSystem::MIN_PARTICLES_PER_CHUNK, function);
+    }
+    else
+    {
+        function(0, count);
+    }
 }
 
 // ----------------------------------------------------------------------------
 // Emitter Management
 //
 
-void ParticleSystem::SpawnEmitter(std::unique_ptr<ParticleEmitter> emitter) { _emitters.push_back(std::move(emitter)); }
+EmitterHandle ParticleSystem::SpawnEmitter(const ParticleEmitter &emitter)
+{
+    if (_recording)
+    {
+        _recording->AddSpawn(_steps, emitter);
+    }
+
+    const auto &particleProps = emitter.GetParticleProperties();
+    const std::uint16_t curveId = _curves.Intern(particleProps.curves);
+    return _emitters.Spawn(emitter, curveId, _particles.palette.Encode(particleProps.color));
+}
+
+EffectTemplate ParticleSystem::CompileEffect(const std::vector<ParticleEmitter> &emitters)
+{
+    EffectTemplate effect;
+    for (const ParticleEmitter &emitter : emitters)
+    {
+        const auto &particleProps = emitter.GetParticleProperties();
+        const std::uint16_t curveId = _curves.Intern(particleProps.curves);
+        EmitterPool::AddToEffect(effect, emitter, curveId, _particles.palette.Encode(particleProps.color));
+    }
+    return effect;
+}
+
+void ParticleSystem::SpawnEffect(const EffectTemplate &effect, const sf::Vector2f &position)
+{
+    // The recording keeps plain emitters, at their absolute position
+    if (_recording)
+    {
+        for (ParticleEmitter emitter : effect.GetEmitters())
+        {
+            emitter.SetPosition(emitter.GetEmitterProperties().position + position);
+            _recording->AddSpawn(_steps, emitter);
+        }
+    }
+
+    _emitters.SpawnEffect(effect, position);
+}
+
+bool ParticleSystem::DespawnEmitter(const EmitterHandle handle) { return _emitters.Despawn(handle); }
+bool ParticleSystem::IsEmitterAlive(const EmitterHandle handle) const { return _emitters.IsAlive(handle); }
+void ParticleSystem::SetRecording(SceneRecording *recording) { _recording = recording; }
+size_t ParticleSystem::GetNumberOfEmitters() const { return _emitters.GetSize(); }
+const CurveLibrary &ParticleSystem::GetCurves() const { return _curves; }
 
 // ----------------------------------------------------------------------------
 // Particle Management
 //
 
-void ParticleSystem::SpawnParticle(const sf::Vector2f position, const sf::Vector2f velocity, const sf::Color color,
+void ParticleSystem::SpawnParticle(const sf::Vector2f position, const sf::Vector2f velocity, const ParticleColor color,
                                    const float lifeTime)
 {
-    _particles.positions.emplace_back(position);
-    _particles.velocities.emplace_back(velocity);
-    _particles.scales.emplace_back(sf::Vector2f{1.f, 1.f});
-    _particles.colors.emplace_back(color);
-    _particles.lifeTimes.emplace_back(lifeTime);
-    _particles.timeRemainder.emplace_back(lifeTime);
+    const ParticleBatch batch = SpawnParticles(1);
+    if (batch.count == 0)
+    {
+        return;
+    }
+
+    *batch.positions = position;
+    *batch.velocities = ParticleStorage::EncodeVelocity(velocity);
+    *batch.scales = sf::Vector2f{1.f, 1.f};
+    *batch.colors = _particles.palette.Encode(color);
+    *batch.rotations = 0.f;
+    *batch.spins = 0.f;
+    *batch.frames = 0;
+    *batch.lifeTimes = ParticleStorage::EncodeLifeTime(lifeTime);
+    *batch.timeRemainder = ParticleStorage::EncodeTimeRemainder(lifeTime, lifeTime);
+    *batch.curveIds = CurveLibrary::CONSTANT;
 }
 
-bool ParticleSystem::HasExpired(const size_t i) const { return _particles.timeRemainder[i] <= 0.f; }
+ParticleBatch ParticleSystem::SpawnParticles(size_t count)
+{
+    if (_overflowPolicy != OverflowPolicy::Grow && _particles.positions.size() + count > _capacity)
+    {
+        // Never more than the whole pool in one spawn
+        if (count > _capacity)
+        {
+            _droppedSpawns += count - _capacity;
+            count = _capacity;
+        }
+
+        // More than count when the pool is already over the capacity (it grew under OverflowPolicy::Grow before the
+        // policy changed): the recycling policies bring it back to the capacity, DropNew drops the whole spawn
+        const size_t missing = _particles.positions.size() + count - _capacity;
+        if (_overflowPolicy == OverflowPolicy::DropNew)
+        {
+            const size_t dropped = std::min(missing, count);
+            _droppedSpawns += dropped;
+            count -= dropped;
+        }
+        else
+        {
+            // Selecting the particles to recycle is a pass over the whole pool, free some headroom at the same time
+            // so the next spawns don't pay for it again
+            RecycleParticles(std::max(missing, _capacity / RECYCLE_HEADROOM_DIVISOR));
+        }
+    }
+
+    const size_t first = _particles.positions.size();
+    PARTICLES_STAT_ADD(_stats, StatCounter::Spawned, count);
+    PARTICLES_STAT_ADD(_stats, StatCounter::Reallocations, first + count > _particles.positions.capacity());
+    _particles.ForEachArray([first, count](auto &array) { array.resize(first + count); });
+
+    ParticleBatch batch;
+    batch.positions = _particles.positions.data() + first;
+    batch.velocities = _particles.velocities.data() + first;
+    batch.scales = _particles.scales.data() + first;
+    batch.colors = _particles.colors.data() + first;
+    batch.rotations = _particles.rotations.data() + first;
+    batch.spins = _particles.spins.data() + first;
+    batch.frames = _particles.frames.data() + first;
+    batch.lifeTimes = _particles.lifeTimes.data() + first;
+    batch.timeRemainder = _particles.timeRemainder.data() + first;
+    batch.curveIds = _particles.curveIds.data() + first;
+    batch.count = count;
+
+    return batch;
+}
+
+bool ParticleSystem::HasExpired(const size_t i) const { return _particles.HasExpired(i); }
 bool ParticleSystem::IsOutOfBounds(const size_t index) const
 {
     return _particles.positions[index].x > _screenWidth || _particles.positions[index].y > _screenHeight ||
@@ -57,75 +285,467 @@ bool ParticleSystem::IsOutOfBounds(const size_t index) const
 void ParticleSystem::KillParticle(const size_t index)
 {
     // Get the last particle and replace the one we want to kill
-    _particles.positions[index] = _particles.positions.back();
-    _particles.velocities[index] = _particles.velocities.back();
-    _particles.scales[index] = _particles.scales.back();
-    _particles.colors[index] = _particles.colors.back();
-    _particles.lifeTimes[index] = _particles.lifeTimes.back();
-    _particles.timeRemainder[index] = _particles.timeRemainder.back();
-
-    _particles.positions.pop_back();
-    _particles.velocities.pop_back();
-    _particles.scales.pop_back();
-    _particles.colors.pop_back();
-    _particles.lifeTimes.pop_back();
-    _particles.timeRemainder.pop_back();
-
-    _vertices[index] = sf::Vertex(); // Reset the vertex to avoid flickering
+    _verticesWritten = std::min(_verticesWritten, index);
+    _spatialGridStale = true;
+    _particles.ForEachArray(
+            [index](auto &array)
+            {
+                array[index] = array.back();
+                array.pop_back();
+            });
 }
 
 // ----------------------------------------------------------------------------
 // Update, Render
 //
 
+void ParticleSystem::SetFixedTimestep(const float tickRate, const unsigned maxSteps)
+{
+    _fixedTimestep = tickRate > 0.f ? sf::seconds(1.f / tickRate) : sf::Time::Zero;
+    _maxSteps = std::max(maxSteps, 1u);
+    _accumulator = sf::Time::Zero;
+}
+
+sf::Time ParticleSystem::GetFixedTimestep() const { return _fixedTimestep; }
+void ParticleSystem::SetInterpolation(const bool enabled) { _interpolation = enabled; }
+
+float ParticleSystem::GetRenderDelay() const
+{
+    if (!_interpolation || _fixedTimestep == sf::Time::Zero)
+    {
+        return 0.f;
+    }
+    return (_fixedTimestep - _accumulator).asSeconds();
+}
+
+unsigned ParticleSystem::Advance(const sf::Time &frameTime)
+{
+    PARTICLES_TRACE_SCOPE("ParticleSystem::Advance");
+    if (_fixedTimestep == sf::Time::Zero)
+    {
+        Update(frameTime);
+        return 1;
+    }
+
+    // Accumulated in microseconds, the remainders add up without drifting
+    _stats.NextFrame();
+    _accumulator += frameTime;
+    unsigned steps = 0;
+    while (_accumulator >= _fixedTimestep && steps < _maxSteps)
+    {
+        Step(_fixedTimestep);
+        _accumulator -= _fixedTimestep;
+        ++steps;
+    }
+
+    // A stall longer than the steps allowed: drop the rest instead of running late on the following frames
+    if (_accumulator >= _fixedTimestep)
+    {
+        _accumulator = sf::Time::Zero;
+    }
+    return steps;
+}
+
 void ParticleSystem::Update(const sf::Time &time)
 {
-    const auto elapsed = time.asSeconds();
+    PARTICLES_TRACE_SCOPE("ParticleSystem::Update");
+    _stats.NextFrame();
+    Step(time);
+}
+
+ParticleStats &ParticleSystem::GetStats() const { return _stats; }
+unsigned long long ParticleSystem::GetStepCount() const { return _steps; }
+
+void ParticleSystem::Step(const sf::Time &time)
+{
+    PARTICLES_TRACE_SCOPE("ParticleSystem::Step");
+    ++_steps;
+    KillParticles();
+    ApplyAffectors(time);
+    Collide(time);
+    Integrate(time);
+    UpdateEmitters(time);
+    // Last, the spawns may have recycled (and so moved) particles
+    BuildSpatialGrid();
+}
+
+void ParticleSystem::KillParticles()
+{
+    PARTICLES_STAT_SCOPE(_stats, StatStage::Kill);
+    PARTICLES_TRACE_SCOPE("ParticleSystem::KillParticles");
+    const size_t before = _particles.positions.size();
+    _expired = 0;
+
+    // Integrate rewrites all the vertices after the kill pass
+    _verticesWritten = 0;
+
+    switch (_killMode)
+    {
+        case KillMode::SwapAndPop:
+            SwapAndPopDeadParticles();
+            break;
+        case KillMode::Compact:
+            CompactDeadParticles();
+            break;
+        case KillMode::CompactStable:
+            CompactDeadParticlesStable();
+            break;
+    }
+
+    if constexpr (ParticleStats::ENABLED)
+    {
+        // Fewer than _collisionKills expired when a spawn recycled some of them since
+        const size_t killed = before - _particles.positions.size();
+        const size_t collided = std::min(_collisionKills, _expired);
+        _stats.Add(StatCounter::KilledExpired, _expired - collided);
+        _stats.Add(StatCounter::KilledOutOfBounds, killed - _expired + collided);
+    }
+    _collisionKills = 0;
+}
+
+void ParticleSystem::SwapAndPopDeadParticles()
+{
     for (int i = _particles.positions.size() - 1; i >= 0; --i)
     {
         if (HasExpired(i) || IsOutOfBounds(i))
         {
+            _expired += HasExpired(i);
             // Kill the particle as it reached the end of its life
             KillParticle(i);
-            continue;
         }
+    }
+}
 
-        // Particle Physics Calculations
-        _particles.positions[i] += _particles.velocities[i] * elapsed;
-        _particles.timeRemainder[i] -= elapsed;
+size_t ParticleSystem::ComputeAliveMask()
+{
+    const size_t count = _particles.positions.size();
+    _aliveMask.resize(count);
+
+    // Same tests as HasExpired and IsOutOfBounds, run by the SIMD kernel
+    const auto *positions = reinterpret_cast<const float *>(_particles.positions.data());
+    const ParticleStorage::LifeTime *lifeTimes = _particles.lifeTimes.data();
+    const ParticleStorage::TimeRemainder *timeRemainder = _particles.timeRemainder.data();
+    unsigned char *aliveMask = _aliveMask.data();
+    const auto width = static_cast<float>(_screenWidth);
+    const auto height = static_cast<float>(_screenHeight);
+    std::atomic<size_t> expired{0};
+    ForEachChunk(count,
+                 [=, &expired](const size_t begin, const size_t end)
+                 {
+                     ForEachTimeBlock<false>(timeRemainder + begin, lifeTimes + begin, end - begin, 0.f,
+                                             [&](const float *seconds, const size_t offset, const size_t n)
+                                             {
+                                                 const size_t first = begin + offset;
+                                                 SimdKernels::ComputeAliveMask(positions + first * 2, seconds,
+                                                                               aliveMask + first, n, width, height);
+                                             });
+                     if constexpr (ParticleStats::ENABLED)
+                     {
+                         // While the chunk is still in the cache
+                         size_t chunkExpired = 0;
+                         for (size_t i = begin; i < end; ++i)
+                         {
+                             chunkExpired += ParticleStorage::HasExpired(timeRemainder[i]);
+                         }
+                         expired += chunkExpired;
+                     }
+                 });
+    _expired = expired;
+
+    return std::find(_aliveMask.begin(), _aliveMask.end(), 0) - _aliveMask.begin();
+}
+
+void ParticleSystem::CompactDeadParticles()
+{
+    const size_t firstDead = ComputeAliveMask();
+    if (firstDead == _aliveMask.size())
+    {
+        return;
     }
 
-    for (int i = _emitters.size() - 1; i >= 0; --i)
+    RemoveFlaggedParticles(firstDead);
+}
+
+void ParticleSystem::RemoveFlaggedParticles(const size_t firstDead)
+{
+    // Pair every hole with the last alive particle, scanning from both ends once
+    _moveFrom.clear();
+    _moveTo.clear();
+    const unsigned char *aliveMask = _aliveMask.data();
+    size_t end = _aliveMask.size();
+    for (size_t i = firstDead; i < end; i = std::find(aliveMask + i + 1, aliveMask + end, 0) - aliveMask)
     {
-        _emitters[i]->Update(time);
-        if (!_emitters[i]->IsActive())
+        while (end > i + 1 && !aliveMask[end - 1])
+        {
+            --end;
+        }
+
+        if (end == i + 1)
         {
-            _emitters.erase(_emitters.begin() + i);
-            --i;
+            // Everything from here to the end is dead
+            end = i;
+            break;
         }
+
+        --end;
+        _moveFrom.push_back(end);
+        _moveTo.push_back(i);
     }
 
-    // TODO: This is adding another loop over all the particles
-    UpdateVertices();
+    // Then one pass per array, touching only the holes and the tail
+    _particles.ForEachArray([this, end](auto &array) { CompactArray(array, _moveFrom, _moveTo, end); });
+
+    // The vertices from the first hole on no longer match their particle, nor does the grid
+    _verticesWritten = std::min(_verticesWritten, firstDead);
+    _spatialGridStale = true;
 }
 
-void ParticleSystem::UpdateVertices()
+void ParticleSystem::RecycleParticles(const size_t count)
 {
-    // Resize the vertex array to match the number of particles
-    _vertices.resize(_particles.positions.size());
+    const size_t size = _particles.positions.size();
+    if (count == 0 || size == 0)
+    {
+        return;
+    }
+
+    // The smallest keys are recycled first: the negative age for the oldest, the time left for the shortest life
+    const bool oldest = _overflowPolicy == OverflowPolicy::RecycleOldest;
+    const Particles &particles = _particles;
+    _recycleKeys.resize(size);
+    float *keys = _recycleKeys.data();
+    float minKey = std::numeric_limits<float>::max();
+    float maxKey = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < size; ++i)
+    {
+        keys[i] = oldest ? -particles.GetAge(i) : particles.GetTimeRemainder(i);
+        minKey = std::min(minKey, keys[i]);
+        maxKey = std::max(maxKey, keys[i]);
+    }
+
+    // Histogram of the keys: everything in the buckets below the one that reaches count particles is recycled, plus
+    // as many particles of that bucket as needed. Cheaper than an exact selection, the order within the last
+    // bucket is approximate.
+    std::array<size_t, RECYCLE_BUCKETS> histogram{};
+    const float scale = maxKey > minKey ? static_cast<float>(RECYCLE_BUCKETS) / (maxKey - minKey) : 0.f;
+    const auto bucket = [=](const float key)
+    { return std::min(static_cast<size_t>((key - minKey) * scale), RECYCLE_BUCKETS - 1); };
+    for (size_t i = 0; i < size; ++i)
+    {
+        ++histogram[bucket(keys[i])];
+    }
+
+    const size_t target = std::min(count, size);
+    size_t lastBucket = 0;
+    size_t below = 0;
+    while (below + histogram[lastBucket] < target)
+    {
+        below += histogram[lastBucket++];
+    }
+
+    _aliveMask.resize(size);
+    size_t fromLastBucket = target - below;
+    for (size_t i = 0; i < size; ++i)
+    {
+        const size_t b = bucket(keys[i]);
+        bool recycle = b < lastBucket;
+        if (b == lastBucket && fromLastBucket > 0)
+        {
+            recycle = true;
+            --fromLastBucket;
+        }
+        _aliveMask[i] = !recycle;
+    }
+
+    _recycledParticles += target;
+    RemoveFlaggedParticles(std::find(_aliveMask.begin(), _aliveMask.end(), 0) - _aliveMask.begin());
+}
+
+void ParticleSystem::CompactDeadParticlesStable()
+{
+    const size_t firstDead = ComputeAliveMask();
+    if (firstDead == _aliveMask.size())
+    {
+        return;
+    }
+
+    _particles.ForEachArray([this, firstDead](auto &array) { CompactArrayStable(array, _aliveMask, firstDead); });
+    _spatialGridStale = true;
+}
 
-    // Update each vertex with its particle data
-    for (size_t i = 0; i < _particles.positions.size(); ++i)
+void ParticleSystem::SetSpatialGrid(const bool enabled, const float cellSize)
+{
+    if (!enabled)
     {
-        _vertices[i].position = _particles.positions[i];
-        _vertices[i].color = _particles.colors[i];
+        _spatialGrid.reset();
+        return;
     }
+
+    // Cover the screen, the particles outside are killed anyway
+    _spatialGrid = std::make_unique<SpatialGrid>(static_cast<float>(_screenWidth), static_cast<float>(_screenHeight),
+                                                 cellSize);
+    _spatialGridStale = true;
 }
 
+const SpatialGrid *ParticleSystem::GetSpatialGrid() const { return _spatialGridStale ? nullptr : _spatialGrid.get(); }
 
-void ParticleSystem::Render(sf::RenderWindow &target) const { target.draw(_vertices); }
+void ParticleSystem::BuildSpatialGrid()
+{
+    PARTICLES_STAT_SCOPE(_stats, StatStage::Grid);
+    PARTICLES_TRACE_SCOPE("ParticleSystem::BuildSpatialGrid");
+    if (_spatialGrid)
+    {
+        _spatialGrid->Build(_particles.positions.data(), _particles.positions.size());
+        _spatialGridStale = false;
+    }
+}
+
+void ParticleSystem::ClearAffectors() { _affectors.reset(); }
+
+void ParticleSystem::ApplyAffectors(const sf::Time &time)
+{
+    PARTICLES_STAT_SCOPE(_stats, StatStage::Affect);
+    PARTICLES_TRACE_SCOPE("ParticleSystem::ApplyAffectors");
+    if (!_affectors)
+    {
+        return;
+    }
+
+    // One virtual call per chunk, the affector loops are specialized in AffectorList
+    const AffectorStage *affectors = _affectors.get();
+    const sf::Vector2f *positions = _particles.positions.data();
+    ParticleStorage::Velocity *velocities = _particles.velocities.data();
+    const AffectorContext context{time.asSeconds(), _time};
+    ForEachChunk(_particles.positions.size(),
+                 [=](const size_t begin, const size_t end)
+                 {
+                     ForEachVelocityBlock<true>(velocities + begin, end - begin,
+                                                [&](sf::Vector2f *block, const size_t offset, const size_t n)
+                                                { affectors->Apply(positions + begin + offset, block, n, context); });
+                 });
+}
+
+CollisionSurfaces &ParticleSystem::GetCollisionSurfaces() { return _collisionSurfaces; }
+
+size_t ParticleSystem::GetNumberOfCollisions() const { return _collisions; }
+
+void ParticleSystem::Collide(const sf::Time &time)
+{
+    PARTICLES_STAT_SCOPE(_stats, StatStage::Collide);
+    PARTICLES_TRACE_SCOPE("ParticleSystem::Collide");
+    _collisions = 0;
+    if (_collisionSurfaces.IsEmpty())
+    {
+        return;
+    }
+
+    _collisionSurfaces.UpdateBroadphase();
+    const CollisionSurfaces *surfaces = &_collisionSurfaces;
+    sf::Vector2f *positions = _particles.positions.data();
+    ParticleStorage::Velocity *velocities = _particles.velocities.data();
+    const ParticleStorage::LifeTime *lifeTimes = _particles.lifeTimes.data();
+    ParticleStorage::TimeRemainder *timeRemainder = _particles.timeRemainder.data();
+    const float elapsed = time.asSeconds();
+    std::atomic<size_t> collisions{0};
+    std::atomic<size_t> collisionKills{0};
+    ForEachChunk(_particles.positions.size(),
+                 [=, &collisions, &collisionKills](const size_t begin, const size_t end)
+                 {
+                     size_t hits = 0;
+                     size_t kills = 0;
+                     ForEachVelocityBlock<true>(velocities + begin, end - begin,
+                                                [&](sf::Vector2f *block, const size_t offset, const size_t n)
+                                                {
+                                                    // Only the kills change the times, nothing to round
+                                                    const size_t first = begin + offset;
+                                                    ForEachTimeBlock<true>(
+                                                            timeRemainder + first, lifeTimes + first, n, 0.f,
+                                                            [&](float *seconds, const size_t at, const size_t m)
+                                                            {
+                                                                hits += surfaces->Collide(positions + first + at,
+                                                                                          block + at, seconds, m,
+                                                                                          elapsed, kills);
+                                                            });
+                                                });
+                     collisions += hits;
+                     collisionKills += kills;
+                 });
+    _collisions = collisions;
+    _collisionKills += collisionKills;
+}
+
+void ParticleSystem::Integrate(const sf::Time &time)
+{
+    PARTICLES_STAT_SCOPE(_stats, StatStage::Integrate);
+    PARTICLES_TRACE_SCOPE("ParticleSystem::Integrate");
+    // Particle Physics Calculations, run by the SIMD kernel
+    const size_t count = _particles.positions.size();
+    const auto elapsed = time.asSeconds();
+    _time += elapsed;
+    auto *positions = reinterpret_cast<float *>(_particles.positions.data());
+    const ParticleStorage::Velocity *velocities = _particles.velocities.data();
+    const ParticleStorage::LifeTime *lifeTimes = _particles.lifeTimes.data();
+    ParticleStorage::TimeRemainder *timeRemainder = _particles.timeRemainder.data();
+    const float roundingOffset = TimeRoundingOffset(_time);
+    // Integrate [begin, end), the velocities are only read
+    const auto integrate = [=](const size_t begin, const size_t end)
+    {
+        ForEachVelocityBlock<false>(
+                velocities + begin, end - begin,
+                [&](const sf::Vector2f *block, const size_t offset, const size_t n)
+                {
+                    const size_t first = begin + offset;
+                    ForEachTimeBlock<true>(timeRemainder + first, lifeTimes + first, n, roundingOffset,
+                                           [&](float *seconds, const size_t timeOffset, const size_t timeCount)
+                                           {
+                                               const size_t particle = first + timeOffset;
+                                               SimdKernels::Integrate(
+                                                       positions + particle * 2,
+                                                       reinterpret_cast<const float *>(block + timeOffset),
+                                                       seconds, timeCount, elapsed);
+                                           });
+                });
+    };
+
+    if (!_fusedVertexBuild)
+    {
+        ForEachChunk(count, integrate);
+        return;
+    }
+
+    // Fused: integrate a small block, then copy it to the vertices while it's still in the cache
+    _vertices.resize(count);
+    _verticesWritten = count;
+    const CurveLibrary *curves = &_curves;
+    const Particles *particles = &_particles;
+    ParticleVertex *vertices = _vertices.data();
+    ForEachChunk(count,
+                 [=](const size_t begin, const size_t end)
+                 {
+                     for (size_t block = begin; block < end; block += FUSED_BLOCK_SIZE)
+                     {
+                         const size_t blockEnd = std::min(block + FUSED_BLOCK_SIZE, end);
+                         integrate(block, blockEnd);
+                         curves->WriteVertices(*particles, block, blockEnd, vertices);
+                     }
+                 });
+}
+
+void ParticleSystem::UpdateEmitters(const sf::Time &time)
+{
+    PARTICLES_STAT_SCOPE(_stats, StatStage::Emit);
+    PARTICLES_TRACE_SCOPE("ParticleSystem::UpdateEmitters");
+    _emitters.Update(time, *this);
+
+    // The vertices of the existing particles were written by Integrate
+    if (_fusedVertexBuild)
+    {
+        WriteVertices(std::min(_verticesWritten, _particles.positions.size()), _particles.positions.size());
+    }
+}
 
 unsigned long long ParticleSystem::GetNumberOfParticles() const
 {
     return _particles.positions.size();
 }
+
+const Particles &ParticleSystem::GetParticles() const { return _particles; }
@@ -4,52 +4,275 @@
 #ifndef PARTICLESYSTEM_H
 #define PARTICLESYSTEM_H
 
-#include <SFML/Graphics/RectangleShape.hpp>
-#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/System/Time.hpp>
+#include <memory>
+#include <vector>
 
+#include "Affectors.h"
+#include "CollisionSurfaces.h"
+#include "EmitterPool.h"
+#include "JobSystem.h"
+#include "LifetimeCurves.h"
+#include "ParticleStats.h"
+#include "ParticleVertex.h"
 #include "Particles.h"
+#include "SpatialGrid.h"
+
+// How the dead particles are removed from the SoA
+enum class KillMode
+{
+    // Replace every dead particle by the last one, one at a time, in all the arrays together
+    SwapAndPop,
+    // Compute the alive mask in one pass, then fill the holes with the last alive particles array by array
+    Compact,
+    // Compute the alive mask in one pass, then compact each array in a single streaming pass that keeps the order
+    CompactStable
+};
+
+// What happens to the spawns that don't fit in the capacity given to ParticleSystem::Initialize
+enum class OverflowPolicy
+{
+    // The capacity is only a reservation, the arrays grow (and reallocate) as needed
+    Grow,
+    // The capacity is hard, the spawns that don't fit are dropped
+    DropNew,
+    // The capacity is hard, the particles that lived the longest are removed to make room (at least 1/16 of the
+    // capacity at once, so the selection pass over the pool is amortized over the following spawns)
+    RecycleOldest,
+    // The capacity is hard, the particles closest to expiring are removed to make room (same batching)
+    RecycleShortestLife
+};
 
 // Forward Declaration
-class ParticleEmitter;
+class SceneRecording;
+
 class ParticleSystem {
 public:
+    // Steps a frame can run with a fixed timestep before the rest of its time is dropped
+    static constexpr unsigned DEFAULT_MAX_STEPS = 4;
+
     ParticleSystem(const unsigned screenWidth, const unsigned screenHeight);
     ~ParticleSystem() = default;
 
+    // Allocate every buffer for nbrParticles particles, with a hard capacity no allocation happens after this
     void Initialize(unsigned nbrParticles);
+    // Select what happens when a spawn doesn't fit in the capacity (see OverflowPolicy)
+    void SetOverflowPolicy(OverflowPolicy policy);
+    OverflowPolicy GetOverflowPolicy() const;
+    size_t GetCapacity() const;
+    // Particles that were not spawned because the capacity was reached (OverflowPolicy::DropNew, or a single
+    // spawn larger than the capacity)
+    unsigned long long GetDroppedSpawns() const;
+    // Particles removed to make room for new ones (OverflowPolicy::Recycle*)
+    unsigned long long GetRecycledParticles() const;
 
     // Create and manage particles
-    void SpawnParticle(sf::Vector2f position, sf::Vector2f velocity, sf::Color color, float lifeTime);
+    void SpawnParticle(sf::Vector2f position, sf::Vector2f velocity, ParticleColor color, float lifeTime);
+    // Grow every array once by count particles and return the new range, the caller must fill all its arrays.
+    // With a hard capacity the batch can be smaller than count (see OverflowPolicy).
+    ParticleBatch SpawnParticles(size_t count);
     // Calculate if a particle is out of the bounds defined by screenWidth and screenHeight
     bool IsOutOfBounds(const size_t index) const;
     void KillParticle(const size_t index);
     bool HasExpired(size_t i) const;
+    // Select how KillParticles removes the dead particles
+    void SetKillMode(KillMode mode);
+    KillMode GetKillMode() const;
+    // The boundaries given to the constructor
+    unsigned GetScreenWidth() const;
+    unsigned GetScreenHeight() const;
+
+    // Split the integration, the expiry tests and the vertex building over threadCount threads (0 uses the
+    // number of cores, 1 runs everything on the calling thread). The compaction stays on the calling thread.
+    void SetThreadCount(unsigned threadCount);
+    // The worker pool, nullptr when single-threaded
+    JobSystem *GetJobSystem() const;
+
+    // When enabled, Integrate writes the vertices of the particles in the same sweep (and UpdateEmitters the ones
+    // of the new particles), so the particle data is only touched once per frame. Requires the stages to run in
+    // the order of Update.
+    void SetFusedVertexBuild(bool enabled);
+    bool IsFusedVertexBuild() const;
+    // The vertices written by the fused vertex build, one point per particle
+    const std::vector<ParticleVertex> &GetVertices() const;
 
-    // Create and manage emitters
-    void SpawnEmitter(std::unique_ptr<ParticleEmitter> emitter);
+    // Create and manage emitters, the emitter is copied into the pool
+    EmitterHandle SpawnEmitter(const ParticleEmitter &emitter);
+    // Stop the emitter before its duration, returns false if it was already gone
+    bool DespawnEmitter(EmitterHandle handle);
+    bool IsEmitterAlive(EmitterHandle handle) const;
+    // Bake the curves and the colors of a set of emitters once (positions relative to the spawn point), then spawn
+    // them all at position in one copy. The template is only valid for this system, compile it again after
+    // ParticleSnapshot::Load.
+    EffectTemplate CompileEffect(const std::vector<ParticleEmitter> &emitters);
+    void SpawnEffect(const EffectTemplate &effect, const sf::Vector2f &position);
+    // Append every emitter spawned from now on to recording, with the step it was spawned before (see
+    // SceneRecording). nullptr stops recording; the recording must outlive the system or be reset first.
+    void SetRecording(SceneRecording *recording);
+    size_t GetNumberOfEmitters() const;
+    // The lifetime curves of the spawned emitters, baked by SpawnEmitter and applied by the vertex builds
+    const CurveLibrary &GetCurves() const;
 
-    void UpdateVertices();
-    // Time function update
+    // When enabled, the particles are sorted into a grid over the screen at the end of every step, for the local queries
+    // (radius, rectangle) of the game code. The affectors don't use it: they run over every particle.
+    void SetSpatialGrid(bool enabled, float cellSize = SpatialGrid::DEFAULT_CELL_SIZE);
+    // The grid of the last step, query it with GetParticles().positions. nullptr when disabled, and from the moment
+    // particles are removed or moved (kill pass, recycling spawn, snapshot load) until the next build. The particles
+    // spawned since the build are not in it.
+    const SpatialGrid *GetSpatialGrid() const;
+
+    // Static surfaces the particles bounce on or die against, checked every frame before the integration
+    CollisionSurfaces &GetCollisionSurfaces();
+    // Particles that hit a surface during the last collision pass
+    size_t GetNumberOfCollisions() const;
+
+    // Replace the affectors applied to the velocities every frame (see AffectorList), returns the list so the
+    // parameters of the affectors can be changed later
+    template <class... Affectors>
+    AffectorList<Affectors...> &SetAffectors(Affectors... affectors);
+    void ClearAffectors();
+
+    // Run the simulation at tickRate steps per second whatever the frame rate (see Advance), at most maxSteps per
+    // frame: the time of a longer stall is dropped instead of being caught up. A tickRate of 0 disables it.
+    void SetFixedTimestep(float tickRate, unsigned maxSteps = DEFAULT_MAX_STEPS);
+    // The duration of a step, zero without a fixed timestep
+    sf::Time GetFixedTimestep() const;
+    // When enabled with a fixed timestep, the vertices are built between the last two steps, at the time the
+    // accumulator is behind (see GetRenderDelay). The previous positions aren't stored, they are derived from the
+    // velocities, which is exact except for the particles that bounced during the last step. The fused vertex build
+    // can't interpolate, the renderer then builds the points itself.
+    void SetInterpolation(bool enabled);
+    // How far back along their velocity the particles are drawn, in seconds: the part of the last step the frame
+    // time didn't reach yet. Zero without interpolation.
+    float GetRenderDelay() const;
+
+    // Frame update: accumulate the frame time and run as many fixed steps as it covers, or a single step with the
+    // frame time without a fixed timestep. Returns the number of steps run.
+    unsigned Advance(const sf::Time &frameTime);
+    // Time function update, runs the stages below in order: kill, affect, collide, integrate, emit, grid
     void Update(const sf::Time &time);
-    // Render function with render target
-    void Render(sf::RenderWindow &target) const;
+
+    // Timings of the stages and counters, per frame. Advance and Update close the frame of the stats before running
+    // (so a frame also holds the render that followed the previous update). Mutable: the render layer records its
+    // timings through the const system it reads.
+    ParticleStats &GetStats() const;
+    // Steps run since the creation of the system (Update calls, or fixed steps of Advance)
+    unsigned long long GetStepCount() const;
+
+    // Update stages, public so they can be driven and measured separately (see bench/)
+    // Remove the particles that expired or left the screen
+    void KillParticles();
+    // Apply the affectors to the velocities
+    void ApplyAffectors(const sf::Time &time);
+    // Bounce or kill the particles whose path of this frame crosses a collision surface
+    void Collide(const sf::Time &time);
+    // Move the particles and age them (and write their vertices, see SetFusedVertexBuild)
+    void Integrate(const sf::Time &time);
+    // Update the emitters, spawn their particles and remove the inactive ones
+    void UpdateEmitters(const sf::Time &time);
+    // Rebuild the spatial grid, when enabled
+    void BuildSpatialGrid();
 
     unsigned long long GetNumberOfParticles() const;
+    // Read-only access to the particle data, used by the render layer to build its vertices
+    const Particles &GetParticles() const;
 
 private:
+    // Saves and restores the particles, the emitters and the curves
+    friend class ParticleSnapshot;
+    // Rebuilds the curves of the recorded system, see SceneRecording::CreateSystem
+    friend class SceneRecording;
+
     // Boundaries, outside them the particles are killed
     const unsigned _screenWidth;
     const unsigned _screenHeight;
 
-    // The list of Emitters currently in the system (AoS)
-    std::vector<std::unique_ptr<ParticleEmitter>> _emitters;
+    // The Emitters currently in the system (SoA)
+    EmitterPool _emitters;
+    CurveLibrary _curves;
 
     // Particle data (SoA)
     Particles _particles;
-    // SFML vertices that can be given a position, texture, and color
-    sf::VertexArray _vertices;
-};
 
+    size_t _capacity = 0;
+    OverflowPolicy _overflowPolicy = OverflowPolicy::Grow;
+    unsigned long long _droppedSpawns = 0;
+    unsigned long long _recycledParticles = 0;
+    // Scratch keys used to select the particles to recycle
+    std::vector<float> _recycleKeys;
+
+    KillMode _killMode = KillMode::Compact;
+    // One byte per particle, 1 if the particle survives the current kill pass (KillMode::Compact*)
+    std::vector<unsigned char> _aliveMask;
+    // Moves computed once by KillMode::Compact and replayed on every array: array[_moveTo[k]] = array[_moveFrom[k]]
+    std::vector<size_t> _moveFrom;
+    std::vector<size_t> _moveTo;
+
+    CollisionSurfaces _collisionSurfaces;
+    size_t _collisions = 0;
+    // Particles killed by the surfaces since the last kill pass: Collide expires them, the stats count them with the
+    // out of bounds ones
+    size_t _collisionKills = 0;
+
+    // Optional spatial index (see SetSpatialGrid)
+    std::unique_ptr<SpatialGrid> _spatialGrid;
+    // The particles were removed or moved since the last build, the grid indices no longer match them
+    bool _spatialGridStale = true;
+
+    // Forces applied before the integration, nullptr when there are none
+    std::unique_ptr<AffectorStage> _affectors;
+    // Simulated time, advanced by Integrate
+    float _time = 0.f;
+
+    // Fixed timestep (see SetFixedTimestep), the frame time not simulated yet is kept in _accumulator
+    sf::Time _fixedTimestep;
+    unsigned _maxSteps = DEFAULT_MAX_STEPS;
+    sf::Time _accumulator;
+    bool _interpolation = false;
+    unsigned long long _steps = 0;
+
+    // Where SpawnEmitter and SpawnEffect record the spawns, nullptr when not recording
+    SceneRecording *_recording = nullptr;
+
+    mutable ParticleStats _stats;
+    // Particles found expired by the last kill pass, the others were out of bounds (counted with the stats only)
+    size_t _expired = 0;
+
+    // Optional worker pool (see SetThreadCount)
+    std::unique_ptr<JobSystem> _jobs;
+
+    // Output of the fused vertex build (see SetFusedVertexBuild)
+    bool _fusedVertexBuild = false;
+    std::vector<ParticleVertex> _vertices;
+    // Number of particles, from the first one, whose vertex is up to date
+    size_t _verticesWritten = 0;
+    void WriteVertices(size_t begin, size_t end);
+
+    // Run function(begin, end) over [0, count), in parallel chunks when there is a worker pool
+    void ForEachChunk(size_t count, const std::function<void(size_t, size_t)> &function) const;
+
+    // The stages of Update, without closing the frame of the stats
+    void Step(const sf::Time &time);
+
+    // Kill passes, see KillMode
+    void SwapAndPopDeadParticles();
+    // Fill _aliveMask, returns the index of the first dead particle (or the number of particles if none died)
+    size_t ComputeAliveMask();
+    void CompactDeadParticles();
+    void CompactDeadParticlesStable();
+    // Remove the particles flagged dead in _aliveMask, starting at firstDead (the KillMode::Compact moves)
+    void RemoveFlaggedParticles(size_t firstDead);
+    // Remove count particles chosen by the overflow policy to make room for new ones
+    void RecycleParticles(size_t count);
+};
 
+template <class... Affectors>
+AffectorList<Affectors...> &ParticleSystem::SetAffectors(Affectors... affectors)
+{
+    auto list = std::make_unique<AffectorList<Affectors...>>(std::move(affectors)...);
+    AffectorList<Affectors...> &result = *list;
+    _affectors = std::move(list);
+    return result;
+}
 
 #endif
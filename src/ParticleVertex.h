@@ -0,0 +1,20 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef PARTICLEVERTEX_H
+#define PARTICLEVERTEX_H
+
+#include <SFML/System/Vector2.hpp>
+
+#include "ParticleColor.h"
+
+// Vertex of a particle drawn as a point, as built by CurveLibrary::WriteVertices. It has the layout of sf::Vertex so
+// the render layer draws an array of them as is (checked in ParticleRenderer.cpp).
+struct ParticleVertex
+{
+    sf::Vector2f position;
+    ParticleColor color = ParticleColor::White;
+    sf::Vector2f texCoords;
+};
+
+#endif
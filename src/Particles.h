@@ -5,17 +5,107 @@
 #define PARTICLES_H
 
 #include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
-struct Particles
+#include "ParticleColor.h"
+#include "ParticleStorage.h"
+
+// The particle SoA, the types of the velocities, the colors and the times come from the Storage policy (see
+// ParticleStorage.h)
+template <class Storage>
+struct BasicParticles
 {
     std::vector<sf::Vector2f> positions;
-    std::vector<sf::Vector2f> velocities;
+    std::vector<typename Storage::Velocity> velocities;
+    // Size in pixels of the textured quad, multiplied by the scale curve (points are always one pixel)
     std::vector<sf::Vector2f> scales;
-    std::vector<sf::Color> colors;
+    std::vector<typename Storage::Color> colors;
+    // Rotation of the quad at birth and its angular speed, in radians: the rotation at any age is derived from them
+    // when the quads are built, the update never touches them
+    std::vector<float> rotations;
+    std::vector<float> spins;
+    // Frame of the texture atlas of the renderer
+    std::vector<std::uint16_t> frames;
+
+    std::vector<typename Storage::LifeTime> lifeTimes;
+    std::vector<typename Storage::TimeRemainder> timeRemainder;
+    // Lifetime curves of the particle, id in the CurveLibrary of the system
+    std::vector<std::uint16_t> curveIds;
+
+    // Decodes the colors, shared by all the particles
+    typename Storage::Palette palette;
 
-    std::vector<float> lifeTimes;
-    std::vector<float> timeRemainder;
+    ParticleColor GetColor(const size_t i) const { return palette.Decode(colors[i]); }
+    sf::Vector2f GetVelocity(const size_t i) const { return Storage::DecodeVelocity(velocities[i]); }
+    // In seconds
+    float GetLifeTime(const size_t i) const { return Storage::DecodeLifeTime(lifeTimes[i]); }
+    float GetTimeRemainder(const size_t i) const
+    {
+        return Storage::DecodeTimeRemainder(timeRemainder[i], GetLifeTime(i));
+    }
+    float GetAge(const size_t i) const { return GetLifeTime(i) - GetTimeRemainder(i); }
+    bool HasExpired(const size_t i) const { return Storage::HasExpired(timeRemainder[i]); }
+    // Position rewind seconds ago along the velocity, never before the birth of the particle. Between two steps of
+    // the integration, this is the position of the previous step (see ParticleSystem::SetInterpolation).
+    sf::Vector2f GetPosition(const size_t i, const float rewind) const
+    {
+        return positions[i] - GetVelocity(i) * std::min(rewind, std::max(GetAge(i), 0.f));
+    }
+
+    // Call function on every array of the SoA, used by the operations that must keep them in sync (reserve, compact)
+    template <typename Function>
+    void ForEachArray(Function &&function)
+    {
+        VisitArrays(*this, function);
+    }
+    template <typename Function>
+    void ForEachArray(Function &&function) const
+    {
+        VisitArrays(*this, function);
+    }
+
+private:
+    // Shared by both constnesses of ForEachArray
+    template <typename Self, typename Function>
+    static void VisitArrays(Self &self, Function &function)
+    {
+        function(self.positions);
+        function(self.velocities);
+        function(self.scales);
+        function(self.colors);
+        function(self.rotations);
+        function(self.spins);
+        function(self.frames);
+        function(self.lifeTimes);
+        function(self.timeRemainder);
+        function(self.curveIds);
+    }
 };
 
+// A contiguous range of freshly spawned particles, one pointer per array of the SoA (see
+// ParticleSystem::SpawnParticles). The pointers are invalidated by the next spawn or kill.
+template <class Storage>
+struct BasicParticleBatch
+{
+    sf::Vector2f *positions = nullptr;
+    typename Storage::Velocity *velocities = nullptr;
+    sf::Vector2f *scales = nullptr;
+    typename Storage::Color *colors = nullptr;
+    float *rotations = nullptr;
+    float *spins = nullptr;
+    std::uint16_t *frames = nullptr;
+
+    typename Storage::LifeTime *lifeTimes = nullptr;
+    typename Storage::TimeRemainder *timeRemainder = nullptr;
+    std::uint16_t *curveIds = nullptr;
+
+    std::size_t count = 0;
+};
+
+using Particles = BasicParticles<ParticleStorage>;
+using ParticleBatch = BasicParticleBatch<ParticleStorage>;
+
 #endif
@@ -4,12 +4,16 @@
 #ifndef RANDOMIZER_H
 #define RANDOMIZER_H
 
+#include "DirectionSampler.h"
+#include "Noise.h"
+#include "Xoshiro128.h"
+
 #include <SFML/System/Vector2.hpp>
 #include <algorithm>
-#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <random>
-#include <vector>
 
 enum class DistributionType
 {
@@ -18,12 +22,18 @@ enum class DistributionType
     Perlin
 };
 
+enum class EngineType
+{
+    MersenneTwister, // std::mt19937, the original engine
+    Xoshiro          // xoshiro128++, much cheaper per value (default)
+};
+
 /**
  * AI Generated Randomizer that creates different distribution of random values:
  *
  * - Uniform
  * - Gaussian
- * - Perlin (TODO: doesn't seem to work properly)
+ * - Perlin (smooth sequence: successive values are samples of a noise curve, see Noise)
  *
  *
  * ```
@@ -42,7 +52,14 @@ enum class DistributionType
  *
  * // For 2D Perlin noise directly
  * float noise2D = Randomizer::PerlinNoise2D(x, y);
+ *
+ * // Fill whole arrays at once (hot paths, e.g. emitting a batch of particles)
+ * Randomizer::FillFloats(lifeTimes, count, 1.0f, 3.0f);
+ * Randomizer::FillDirections(velocities, count, direction, angle);
  * ```
+ *
+ * The engines are thread_local: each thread draws from its own stream, seeded from the base seed and the order
+ * in which the threads first use the randomizer, so there is no shared state to contend on.
  */
 class Randomizer
 {
@@ -53,6 +70,24 @@ public:
     // Get the current distribution type
     static DistributionType GetDistributionType() { return currentDistribution; }
 
+    // Select the engine used by the uniform distribution (the other distributions always use it through <random>)
+    static void SetEngineType(const EngineType type) { currentEngine = type; }
+
+    // Get the current engine type
+    static EngineType GetEngineType() { return currentEngine; }
+
+    // Seed the generators of the calling thread and the base seed of the threads that start using the randomizer
+    // afterward, used to get reproducible sequences (benchmarks, replays)
+    static void Seed(const unsigned int seed)
+    {
+        baseSeed = seed;
+        nextThreadIndex = 1;
+        gen.seed(seed);
+        fastGen.Seed(seed);
+        noise.SetSeed(seed);
+        noiseIndex = 0;
+    }
+
     // Random unsigned char
     static unsigned char RandomUnsigned(const unsigned char min, const unsigned char max)
     {
@@ -72,7 +107,7 @@ public:
             case DistributionType::Uniform:
             default:
                 std::uniform_int_distribution<int> dis(min, max);
-                return static_cast<unsigned char>(dis(gen));
+                return static_cast<unsigned char>(currentEngine == EngineType::Xoshiro ? dis(fastGen) : dis(gen));
         }
     }
 
@@ -90,84 +125,110 @@ public:
 
             case DistributionType::Uniform:
             default:
+                if (currentEngine == EngineType::Xoshiro)
+                {
+                    return min + fastGen.NextFloat() * (max - min);
+                }
                 std::uniform_real_distribution<float> distribution(min, max);
                 return distribution(gen);
         }
     }
 
-    // Random vector with x and y components
-    static sf::Vector2f RandomVector(const float minX, const float maxX, const float minY, const float maxY)
+    // Fill count floats in [min, max) using the current distribution
+    static void FillFloats(float *out, const std::size_t count, const float min, const float max)
     {
-        return {RandomFloat(minX, maxX), RandomFloat(minY, maxY)};
+        if (currentDistribution != DistributionType::Uniform || currentEngine != EngineType::Xoshiro)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                out[i] = RandomFloat(min, max);
+            }
+            return;
+        }
+
+        // Work on a local copy of the engine so the state stays in registers instead of going through the TLS slot
+        Xoshiro128 engine = fastGen;
+        const float range = max - min;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = min + engine.NextFloat() * range;
+        }
+        fastGen = engine;
     }
 
-    // Random directional vector
-    static sf::Vector2f RandomDirectionalVector(const sf::Vector2f &direction, const float angle)
+    // Fill count unit vectors pointing within angle / 2 of direction (any direction for a zero vector)
+    static void FillDirections(sf::Vector2f *out, const std::size_t count, const sf::Vector2f &direction,
+                               const float angle)
     {
-        // Special case for zero vectors - create a completely random direction
-        if (direction.x == 0 && direction.y == 0) {
-            // For a zero vector with any angle, create a random direction vector
-            const float randomAngle = RandomFloat(0, 2 * M_PI);
-            return sf::Vector2f(std::cos(randomAngle), std::sin(randomAngle));
+        // The base angle and the arc are computed once for the whole batch
+        const DirectionSampler sampler(direction, angle);
+
+        if (currentDistribution != DistributionType::Uniform || currentEngine != EngineType::Xoshiro)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                out[i] = sampler.Sample(RandomFloat(0.f, 1.f));
+            }
+            return;
         }
 
-        const float baseAngle = std::atan2(direction.y, direction.x);
-        const float randomAngle = baseAngle + RandomFloat(-angle / 2, angle / 2);
-        const float magnitude = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+        Xoshiro128 engine = fastGen;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = sampler.Sample(engine.NextFloat());
+        }
+        fastGen = engine;
+    }
 
-        return sf::Vector2f(magnitude * std::cos(randomAngle), magnitude * std::sin(randomAngle));
+    // Random vector with x and y components
+    static sf::Vector2f RandomVector(const float minX, const float maxX, const float minY, const float maxY)
+    {
+        return {RandomFloat(minX, maxX), RandomFloat(minY, maxY)};
     }
 
-    // Perlin noise 2D
-    static float PerlinNoise2D(float x, float y)
+    // Random directional vector, with the magnitude of direction
+    static sf::Vector2f RandomDirectionalVector(const sf::Vector2f &direction, const float angle)
     {
-        // Initialize the permutation table if not initialized
-        if (!perlinInitialized)
+        const sf::Vector2f unit = DirectionSampler(direction, angle).Sample(RandomFloat(0.f, 1.f));
+
+        // Special case for zero vectors - the sampler returns a completely random unit direction
+        if (direction.x == 0 && direction.y == 0)
         {
-            InitializePerlin();
+            return unit;
         }
 
-        // Get fractional part of x and y
-        const int X = static_cast<int>(std::floor(x)) & 255;
-        const int Y = static_cast<int>(std::floor(y)) & 255;
-        x -= std::floor(x);
-        y -= std::floor(y);
-
-        // Compute fade curves
-        const float u = Fade(x);
-        const float v = Fade(y);
-
-        // Hash coordinates of the 4 square corners
-        const int A = p[X] + Y;
-        const int AA = p[A];
-        const int AB = p[A + 1];
-        const int B = p[X + 1] + Y;
-        const int BA = p[B];
-        const int BB = p[B + 1];
-
-        // Add blended results from 4 corners of the square
-        return Lerp(v, Lerp(u, Grad(p[AA], x, y, 0),
-                                 Grad(p[BA], x - 1, y, 0)),
-                        Lerp(u, Grad(p[AB], x, y - 1, 0),
-                                 Grad(p[BB], x - 1, y - 1, 0)));
+        return unit * direction.length();
     }
 
+    // Perlin noise 2D, roughly in [-1, 1]
+    static float PerlinNoise2D(const float x, const float y) { return noise.Sample(x, y); }
+
     // Reset the Perlin noise index
     static void ResetNoiseIndex() { noiseIndex = 0; }
 
 private:
     static std::random_device rd;
-    static std::mt19937 gen;
+    static std::atomic<std::uint64_t> baseSeed;
+    static std::atomic<std::uint64_t> nextThreadIndex;
+    static thread_local std::uint64_t threadSeed;
+    static thread_local std::mt19937 gen;
+    static thread_local Xoshiro128 fastGen;
+    static EngineType currentEngine;
     static DistributionType currentDistribution;
     static unsigned int noiseIndex;
-    static std::array<int, 512> p; // Permutation table for Perlin noise
-    static bool perlinInitialized;
+    static Noise noise;
+
+    // Seed of the next thread using the randomizer; the first one gets the base seed itself
+    static std::uint64_t NextThreadSeed()
+    {
+        return baseSeed + nextThreadIndex++ * 0x9E3779B97F4A7C15ull;
+    }
 
     // Gaussian distribution helpers
     static float NormalRandomFloat(const float mean, const float stddev)
     {
         std::normal_distribution<float> distribution(mean, stddev);
-        return distribution(gen);
+        return currentEngine == EngineType::Xoshiro ? distribution(fastGen) : distribution(gen);
     }
 
     static float GaussianRandomFloat(const float min, const float max)
@@ -186,60 +247,28 @@ private:
                                             static_cast<float>(max))));
     }
 
-    // Perlin noise helpers
-    static void InitializePerlin()
-    {
-        // Initialize a permutation table with values 0-255
-        std::vector<int> perm(256);
-        for (int i = 0; i < 256; i++)
-        {
-            perm[i] = i;
-        }
-
-        // Shuffle permutation table
-        std::shuffle(perm.begin(), perm.end(), gen);
-
-        // Copy to a double-sized permutation table
-        for (int i = 0; i < 256; i++)
-        {
-            p[i] = p[i + 256] = perm[i];
-        }
-
-        perlinInitialized = true;
-    }
-
-    static float PerlinNoise1D(const float x)
-    {
-        return PerlinNoise2D(x, 0.0f);
-    }
-
-    static float Fade(const float t)
-    {
-        // Fade function: 6t^5 - 15t^4 + 10t^3
-        return t * t * t * (t * (t * 6 - 15) + 10);
-    }
-
-    static float Lerp(const float t, const float a, const float b)
-    {
-        return a + t * (b - a);
-    }
+    // Distance between two successive values of the Perlin sequence: off the lattice points (where the noise is
+    // always 0) and small enough for the values to stay related
+    static constexpr float PERLIN_SEQUENCE_STEP = 0.1f;
 
-    static float Grad(const int hash, const float x, const float y, const float z)
+    // Perlin noise sequence mapped to [0, 1]
+    static float PerlinNoise1D(const unsigned int index)
     {
-        // Convert the lower 4 bits of hash into 12 gradient directions
-        const int h = hash & 15;
-        const float u = h < 8 ? x : y;
-        const float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
-        return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+        const float value = noise.Sample(static_cast<float>(index) * PERLIN_SEQUENCE_STEP, 0.5f);
+        return std::clamp(0.5f + 0.5f * value, 0.f, 1.f);
     }
 };
 
 // Static member initialization
 inline std::random_device Randomizer::rd;
-inline std::mt19937 Randomizer::gen{rd()};
+inline std::atomic<std::uint64_t> Randomizer::baseSeed{rd()};
+inline std::atomic<std::uint64_t> Randomizer::nextThreadIndex{0};
+inline thread_local std::uint64_t Randomizer::threadSeed = NextThreadSeed();
+inline thread_local std::mt19937 Randomizer::gen{static_cast<std::mt19937::result_type>(threadSeed)};
+inline thread_local Xoshiro128 Randomizer::fastGen{threadSeed};
+inline EngineType Randomizer::currentEngine = EngineType::Xoshiro;
 inline DistributionType Randomizer::currentDistribution = DistributionType::Uniform;
 inline unsigned int Randomizer::noiseIndex = 0;
-inline std::array<int, 512> Randomizer::p{};
-inline bool Randomizer::perlinInitialized = false;
+inline Noise Randomizer::noise{static_cast<std::uint32_t>(baseSeed)};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,362 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "SceneRecording.h"
+
+#include <cmath>
+#include <fstream>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+    // "PREC" read as a little endian integer
+    constexpr std::uint32_t MAGIC = 0x43455250;
+    // Most particles a recorded emission may spawn, more is taken as a corrupted file
+    constexpr std::uint32_t MAX_PARTICLES_PER_EMISSION = 1u << 24;
+
+    template <typename T>
+    void Write(std::ostream &stream, const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only plain values are written as is");
+        stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool Read(std::istream &stream, T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only plain values are read as is");
+        return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    // Keys of a curve, prefixed by their count
+    template <typename Key>
+    void WriteKeys(std::ostream &stream, const std::vector<Key> &keys)
+    {
+        Write(stream, static_cast<std::uint32_t>(keys.size()));
+        for (const Key &key : keys)
+        {
+            Write(stream, key);
+        }
+    }
+
+    // Bytes left before end, the size of the file, so a corrupted count can't allocate more than the file holds
+    std::uint64_t GetRemaining(std::istream &stream, const std::uint64_t end)
+    {
+        const std::streamoff position = stream.tellg();
+        return position >= 0 && static_cast<std::uint64_t>(position) < end ? end - position : 0;
+    }
+
+    template <typename Key>
+    bool ReadKeys(std::istream &stream, const std::uint64_t end, std::vector<Key> &keys)
+    {
+        std::uint32_t count = 0;
+        if (!Read(stream, count) || count > GetRemaining(stream, end) / sizeof(Key))
+        {
+            return false;
+        }
+        keys.resize(count);
+        for (Key &key : keys)
+        {
+            if (!Read(stream, key))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Field by field, so the file doesn't depend on the padding of the structs
+    void WriteEmitter(std::ostream &stream, const ParticleEmitter &emitter)
+    {
+        const ParticleEmitter::EmitterProperties &e = emitter.GetEmitterProperties();
+        Write(stream, e.position);
+        Write(stream, e.direction);
+        Write(stream, e.angle);
+        Write(stream, e.duration);
+        Write(stream, static_cast<std::uint32_t>(e.particlesPerEmission));
+        Write(stream, e.emissionRate);
+
+        const ParticleEmitter::ParticleProperties &p = emitter.GetParticleProperties();
+        Write(stream, p.color);
+        Write(stream, p.startColor);
+        Write(stream, p.endColor);
+        Write(stream, p.minLifetime);
+        Write(stream, p.maxLifetime);
+        Write(stream, p.minVelocity);
+        Write(stream, p.maxVelocity);
+        Write(stream, p.minSize);
+        Write(stream, p.maxSize);
+        Write(stream, p.minRotation);
+        Write(stream, p.maxRotation);
+        Write(stream, p.minSpin);
+        Write(stream, p.maxSpin);
+        Write(stream, p.frame);
+        WriteKeys(stream, p.curves.colors);
+        WriteKeys(stream, p.curves.alphas);
+        WriteKeys(stream, p.curves.scales);
+    }
+
+    bool ReadEmitter(std::istream &stream, const std::uint64_t end, ParticleEmitter &emitter)
+    {
+        ParticleEmitter::EmitterProperties e;
+        std::uint32_t particlesPerEmission = 0;
+        bool ok = Read(stream, e.position) && Read(stream, e.direction) && Read(stream, e.angle) &&
+                  Read(stream, e.duration) && Read(stream, particlesPerEmission) && Read(stream, e.emissionRate);
+        e.particlesPerEmission = particlesPerEmission;
+        // The emitters the pool can run: a finite positive rate, a finite duration and a bounded emission
+        ok = ok && std::isfinite(e.emissionRate) && e.emissionRate > 0.f && std::isfinite(e.duration) &&
+             e.duration >= 0.f && particlesPerEmission <= MAX_PARTICLES_PER_EMISSION;
+
+        ParticleEmitter::ParticleProperties p;
+        ok = ok && Read(stream, p.color) && Read(stream, p.startColor) && Read(stream, p.endColor) &&
+             Read(stream, p.minLifetime) && Read(stream, p.maxLifetime) && Read(stream, p.minVelocity) &&
+             Read(stream, p.maxVelocity) && Read(stream, p.minSize) && Read(stream, p.maxSize) &&
+             Read(stream, p.minRotation) && Read(stream, p.maxRotation) && Read(stream, p.minSpin) &&
+             Read(stream, p.maxSpin) && Read(stream, p.frame) && ReadKeys(stream, end, p.curves.colors) &&
+             ReadKeys(stream, end, p.curves.alphas) && ReadKeys(stream, end, p.curves.scales);
+
+        emitter = ParticleEmitter(e, p);
+        return ok;
+    }
+} // namespace
+
+// ----------------------------------------------------------------------------
+// SceneRecording
+//
+
+bool SceneRecording::Start(const ParticleSystem &system, const unsigned seed)
+{
+    if (system.GetFixedTimestep() == sf::Time::Zero || system.GetNumberOfParticles() > 0 ||
+        system.GetNumberOfEmitters() > 0)
+    {
+        return false;
+    }
+
+    _seed = seed;
+    _engine = static_cast<std::uint8_t>(Randomizer::GetEngineType());
+    _distribution = static_cast<std::uint8_t>(Randomizer::GetDistributionType());
+    _width = system.GetScreenWidth();
+    _height = system.GetScreenHeight();
+    _capacity = static_cast<std::uint32_t>(system.GetCapacity());
+    _overflowPolicy = static_cast<std::uint8_t>(system.GetOverflowPolicy());
+    _killMode = static_cast<std::uint8_t>(system.GetKillMode());
+    _timestepUs = system.GetFixedTimestep().asMicroseconds();
+    _startStep = system.GetStepCount();
+    _steps = 0;
+    _checksum = ComputeChecksum(system.GetParticles());
+    _spawns.clear();
+    CaptureTables(system);
+
+    SeedRandomizer();
+    return true;
+}
+
+void SceneRecording::CaptureTables(const ParticleSystem &system)
+{
+    _palette = system.GetParticles().palette;
+    const CurveLibrary &library = system.GetCurves();
+    _curves.clear();
+    for (size_t id = 1; id < library.GetSize(); ++id)
+    {
+        _curves.push_back(library.GetDescription(static_cast<std::uint16_t>(id)));
+    }
+}
+
+void SceneRecording::SeedRandomizer() const
+{
+    Randomizer::SetEngineType(static_cast<EngineType>(_engine));
+    Randomizer::SetDistributionType(static_cast<DistributionType>(_distribution));
+    Randomizer::Seed(_seed);
+}
+
+void SceneRecording::AddSpawn(const unsigned long long systemStep, const ParticleEmitter &emitter)
+{
+    _spawns.push_back({systemStep - _startStep, emitter});
+}
+
+void SceneRecording::Finish(const ParticleSystem &system)
+{
+    _steps = system.GetStepCount() - _startStep;
+    _checksum = ComputeChecksum(system.GetParticles());
+    CaptureTables(system);
+}
+
+std::unique_ptr<ParticleSystem> SceneRecording::CreateSystem() const
+{
+    auto system = std::make_unique<ParticleSystem>(_width, _height);
+    system->Initialize(_capacity);
+    system->SetOverflowPolicy(static_cast<OverflowPolicy>(_overflowPolicy));
+    system->SetKillMode(static_cast<KillMode>(_killMode));
+    // Interned in the order of their ids, they get the same ones back
+    for (const LifetimeCurves &curves : _curves)
+    {
+        system->_curves.Intern(curves);
+    }
+    system->_particles.palette = _palette;
+    return system;
+}
+
+std::uint64_t SceneRecording::ComputeChecksum(const Particles &particles)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    particles.ForEachArray(
+            [&hash](const auto &array)
+            {
+                const auto *bytes = reinterpret_cast<const unsigned char *>(array.data());
+                const size_t size = array.size() * sizeof(array[0]);
+                for (size_t i = 0; i < size; ++i)
+                {
+                    hash = (hash ^ bytes[i]) * 1099511628211ull;
+                }
+            });
+    return hash;
+}
+
+bool SceneRecording::Save(const std::string &path) const
+{
+    std::ofstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        return false;
+    }
+
+    Write(stream, MAGIC);
+    Write(stream, VERSION);
+    Write(stream, _seed);
+    Write(stream, _engine);
+    Write(stream, _distribution);
+    Write(stream, _width);
+    Write(stream, _height);
+    Write(stream, _capacity);
+    Write(stream, _overflowPolicy);
+    Write(stream, _killMode);
+    Write(stream, _timestepUs);
+    Write(stream, _steps);
+    Write(stream, _checksum);
+    Write(stream, static_cast<std::uint32_t>(_spawns.size()));
+    for (const Spawn &spawn : _spawns)
+    {
+        Write(stream, spawn.step);
+        WriteEmitter(stream, spawn.emitter);
+    }
+    Write(stream, static_cast<std::uint32_t>(_curves.size()));
+    for (const LifetimeCurves &curves : _curves)
+    {
+        WriteKeys(stream, curves.colors);
+        WriteKeys(stream, curves.alphas);
+        WriteKeys(stream, curves.scales);
+    }
+    // Its size tells the storage policies apart (see PARTICLES_COMPACT_STORAGE)
+    Write(stream, static_cast<std::uint32_t>(sizeof(_palette)));
+    Write(stream, _palette);
+
+    return static_cast<bool>(stream.flush());
+}
+
+bool SceneRecording::Load(const std::string &path)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    const std::streamoff size = stream.tellg();
+    stream.seekg(0);
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    if (size < 0 || !Read(stream, magic) || !Read(stream, version) || magic != MAGIC || version != VERSION)
+    {
+        return false;
+    }
+    const auto end = static_cast<std::uint64_t>(size);
+
+    // Read into a new recording, this one is only replaced once the whole file was read
+    SceneRecording loaded;
+    std::uint32_t spawnCount = 0;
+    const bool ok = Read(stream, loaded._seed) && Read(stream, loaded._engine) && Read(stream, loaded._distribution) &&
+                    Read(stream, loaded._width) && Read(stream, loaded._height) && Read(stream, loaded._capacity) &&
+                    Read(stream, loaded._overflowPolicy) && Read(stream, loaded._killMode) &&
+                    Read(stream, loaded._timestepUs) && Read(stream, loaded._steps) &&
+                    Read(stream, loaded._checksum) && Read(stream, spawnCount);
+    // A spawn takes at least its step and the counts of the keys of its 3 curves
+    constexpr size_t minSpawnSize = sizeof(std::uint64_t) + 3 * sizeof(std::uint32_t);
+    if (!ok || spawnCount > GetRemaining(stream, end) / minSpawnSize)
+    {
+        return false;
+    }
+
+    loaded._spawns.resize(spawnCount);
+    for (Spawn &spawn : loaded._spawns)
+    {
+        if (!Read(stream, spawn.step) || !ReadEmitter(stream, end, spawn.emitter))
+        {
+            return false;
+        }
+    }
+
+    // A curve takes at least the counts of its keys
+    std::uint32_t curveCount = 0;
+    if (!Read(stream, curveCount) || curveCount > GetRemaining(stream, end) / (3 * sizeof(std::uint32_t)))
+    {
+        return false;
+    }
+    loaded._curves.resize(curveCount);
+    for (LifetimeCurves &curves : loaded._curves)
+    {
+        if (!ReadKeys(stream, end, curves.colors) || !ReadKeys(stream, end, curves.alphas) ||
+            !ReadKeys(stream, end, curves.scales))
+        {
+            return false;
+        }
+    }
+
+    std::uint32_t paletteSize = 0;
+    if (!Read(stream, paletteSize) || paletteSize != sizeof(loaded._palette) || !Read(stream, loaded._palette))
+    {
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// SceneReplay
+//
+
+SceneReplay::SceneReplay(const SceneRecording &recording)
+    : _recording(recording)
+{
+    Restart();
+}
+
+void SceneReplay::Restart()
+{
+    _recording.SeedRandomizer();
+    _step = 0;
+    _next = 0;
+}
+
+bool SceneReplay::NextStep(ParticleSystem &system)
+{
+    if (_step >= _recording.GetStepCount())
+    {
+        return false;
+    }
+
+    const std::vector<SceneRecording::Spawn> &spawns = _recording.GetSpawns();
+    for (; _next < spawns.size() && spawns[_next].step <= _step; ++_next)
+    {
+        system.SpawnEmitter(spawns[_next].emitter);
+    }
+    ++_step;
+    return true;
+}
+
+std::uint64_t SceneReplay::Run(const unsigned threadCount)
+{
+    Restart();
+    const std::unique_ptr<ParticleSystem> system = _recording.CreateSystem();
+    system->SetThreadCount(threadCount);
+    const sf::Time timestep = _recording.GetTimestep();
+    while (NextStep(*system))
+    {
+        system->Update(timestep);
+    }
+    return SceneRecording::ComputeChecksum(system->GetParticles());
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef SCENERECORDING_H
+#define SCENERECORDING_H
+
+#include <SFML/System/Time.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ParticleEmitter.h"
+#include "ParticleSystem.h"
+#include "Randomizer.h"
+
+/**
+ * Recording of a session: the settings of the system, the seed of the Randomizer, and every emitter spawned with
+ * the step it was spawned before. The simulation is deterministic for a given seed and timestep, so replaying the
+ * spawns at the same steps (SceneReplay) rebuilds the exact same particles, checked with the checksum of the state
+ * taken by Finish. The lifetime curves and the color palette of the system are recorded too, so the curves and the
+ * colors registered outside of the spawns (EffectLibrary compiling its effects before or during the recording) keep
+ * their id in the replay. The affectors, the collision surfaces and the spatial grid aren't recorded, a replay runs
+ * without them.
+ *
+ * Saved as a compact binary file (about 100 bytes per spawn) in the byte order of the machine, the magic number
+ * rejects the files of the other byte order and the version the files of another layout.
+ *
+ * ```
+ * SceneRecording recording;
+ * recording.Start(system, seed);       // fixed timestep, no particle yet
+ * system.SetRecording(&recording);
+ * ...
+ * recording.Finish(system);
+ * recording.Save("session.prec");
+ * ```
+ */
+class SceneRecording
+{
+public:
+    static constexpr std::uint32_t VERSION = 2;
+
+    struct Spawn
+    {
+        // Spawned before this step, counted from the start of the recording
+        std::uint64_t step = 0;
+        ParticleEmitter emitter{sf::Vector2f()};
+    };
+
+    // Keep the settings of the system and seed the Randomizer with seed. Returns false if the system doesn't run at
+    // a fixed timestep (the steps are the timestamps of the recording) or isn't empty.
+    bool Start(const ParticleSystem &system, unsigned seed);
+    // Called by ParticleSystem::SpawnEmitter and SpawnEffect, systemStep is the step count of the system
+    void AddSpawn(unsigned long long systemStep, const ParticleEmitter &emitter);
+    // End the recording at the current step of the system, with the checksum of its state, its curves and its
+    // palette. The spawns can keep being recorded, a later Finish extends it.
+    void Finish(const ParticleSystem &system);
+
+    // Return false if the file couldn't be written, or read (missing, truncated, corrupted, other version), a failed
+    // Load leaves the recording as it was
+    bool Save(const std::string &path) const;
+    bool Load(const std::string &path);
+
+    unsigned GetSeed() const { return _seed; }
+    // Seed the Randomizer and select the engine and distribution of the recorded session
+    void SeedRandomizer() const;
+    sf::Time GetTimestep() const { return sf::microseconds(_timestepUs); }
+    std::uint64_t GetStepCount() const { return _steps; }
+    std::uint64_t GetChecksum() const { return _checksum; }
+    const std::vector<Spawn> &GetSpawns() const { return _spawns; }
+
+    // An empty system with the settings, the curves and the palette of the recording
+    std::unique_ptr<ParticleSystem> CreateSystem() const;
+
+    // FNV-1a of the bytes of every array of the SoA
+    static std::uint64_t ComputeChecksum(const Particles &particles);
+
+private:
+    // Settings of the system and of the randomizer
+    std::uint32_t _seed = 0;
+    std::uint8_t _engine = 0;
+    std::uint8_t _distribution = 0;
+    std::uint32_t _width = 0;
+    std::uint32_t _height = 0;
+    std::uint32_t _capacity = 0;
+    std::uint8_t _overflowPolicy = 0;
+    std::uint8_t _killMode = 0;
+    std::int64_t _timestepUs = 0;
+
+    // Step count of the system when the recording started
+    std::uint64_t _startStep = 0;
+    // Length of the recording and state at its end, set by Finish
+    std::uint64_t _steps = 0;
+    std::uint64_t _checksum = 0;
+
+    std::vector<Spawn> _spawns;
+    // The curves of the system by id, from 1 (the constant curve is implicit), and its palette
+    std::vector<LifetimeCurves> _curves;
+    ParticleStorage::Palette _palette;
+
+    // Keep the curves and the palette of the system, they only grow
+    void CaptureTables(const ParticleSystem &system);
+};
+
+/**
+ * Feeds a recording back into a system, headless: NextStep spawns the emitters recorded before the next step, the
+ * caller then runs the step (Update, or the stages one by one to time them).
+ *
+ * ```
+ * SceneReplay replay(recording);
+ * auto system = recording.CreateSystem();
+ * while (replay.NextStep(*system))
+ * {
+ *     system->Update(recording.GetTimestep());
+ * }
+ * const bool identical = SceneRecording::ComputeChecksum(system->GetParticles()) == recording.GetChecksum();
+ * ```
+ */
+class SceneReplay
+{
+public:
+    // Seeds the Randomizer, the recording must outlive the replay
+    explicit SceneReplay(const SceneRecording &recording);
+
+    // Seed the Randomizer again and go back to the first step
+    void Restart();
+    // Spawn the emitters recorded before the next step into system, false once all the recorded steps were given
+    bool NextStep(ParticleSystem &system);
+
+    // Replay the whole recording on a new system split over threadCount threads, returns the checksum of its state
+    std::uint64_t Run(unsigned threadCount = 1);
+
+private:
+    const SceneRecording &_recording;
+    std::uint64_t _step = 0;
+    // Next spawn to replay
+    size_t _next = 0;
+};
+
+#endif
@@ -0,0 +1,253 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if !defined(PARTICLES_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define PARTICLES_SIMD_SSE2 1
+#include <emmintrin.h>
+// AVX2 functions are compiled with a target attribute and only called when the CPU supports them
+#if defined(__GNUC__) || defined(__clang__)
+#define PARTICLES_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace
+{
+    // ------------------------------------------------------------------------
+    // Scalar
+    //
+
+    void IntegrateScalar(float *positions, const float *velocities, float *timeRemainder, const size_t count,
+                         const float elapsed)
+    {
+        for (size_t i = 0; i < count * 2; ++i)
+        {
+            positions[i] += velocities[i] * elapsed;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            timeRemainder[i] -= elapsed;
+        }
+    }
+
+    void ComputeAliveMaskScalar(const float *positions, const float *timeRemainder, unsigned char *aliveMask,
+                                const size_t count, const float width, const float height)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float x = positions[i * 2];
+            const float y = positions[i * 2 + 1];
+            const bool dead = (timeRemainder[i] <= 0.f) | (x > width) | (y > height) | (x < 0.f) | (y < 0.f);
+            aliveMask[i] = !dead;
+        }
+    }
+
+#ifdef PARTICLES_SIMD_SSE2
+    // ------------------------------------------------------------------------
+    // SSE2, 4 particles per iteration
+    //
+
+    void IntegrateSSE2(float *positions, const float *velocities, float *timeRemainder, const size_t count,
+                       const float elapsed)
+    {
+        const __m128 dt = _mm_set1_ps(elapsed);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            // 4 particles are 8 position floats
+            float *p = positions + i * 2;
+            const float *v = velocities + i * 2;
+            _mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(_mm_loadu_ps(v), dt)));
+            _mm_storeu_ps(p + 4, _mm_add_ps(_mm_loadu_ps(p + 4), _mm_mul_ps(_mm_loadu_ps(v + 4), dt)));
+            _mm_storeu_ps(timeRemainder + i, _mm_sub_ps(_mm_loadu_ps(timeRemainder + i), dt));
+        }
+
+        IntegrateScalar(positions + i * 2, velocities + i * 2, timeRemainder + i, count - i, elapsed);
+    }
+
+    void ComputeAliveMaskSSE2(const float *positions, const float *timeRemainder, unsigned char *aliveMask,
+                              const size_t count, const float width, const float height)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 w = _mm_set1_ps(width);
+        const __m128 h = _mm_set1_ps(height);
+        const __m128i one = _mm_set1_epi8(1);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            // De-interleave x0 y0 x1 y1 | x2 y2 x3 y3 into x0 x1 x2 x3 and y0 y1 y2 y3
+            const __m128 a = _mm_loadu_ps(positions + i * 2);
+            const __m128 b = _mm_loadu_ps(positions + i * 2 + 4);
+            const __m128 x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m128 t = _mm_loadu_ps(timeRemainder + i);
+
+            __m128 dead = _mm_cmple_ps(t, zero);
+            dead = _mm_or_ps(dead, _mm_cmpgt_ps(x, w));
+            dead = _mm_or_ps(dead, _mm_cmpgt_ps(y, h));
+            dead = _mm_or_ps(dead, _mm_cmplt_ps(x, zero));
+            dead = _mm_or_ps(dead, _mm_cmplt_ps(y, zero));
+
+            // Narrow the 4 x 32 bits lanes (0 or -1) to 4 bytes and turn them into 1 for alive, 0 for dead
+            __m128i bytes = _mm_packs_epi32(_mm_castps_si128(dead), _mm_castps_si128(dead));
+            bytes = _mm_packs_epi16(bytes, bytes);
+            bytes = _mm_andnot_si128(bytes, one);
+            const int packed = _mm_cvtsi128_si32(bytes);
+            std::memcpy(aliveMask + i, &packed, 4);
+        }
+
+        ComputeAliveMaskScalar(positions + i * 2, timeRemainder + i, aliveMask + i, count - i, width, height);
+    }
+#endif
+
+#ifdef PARTICLES_SIMD_AVX2
+    // ------------------------------------------------------------------------
+    // AVX2, 8 particles per iteration
+    //
+
+    // The compiler doesn't insert vzeroupper in functions compiled with a target attribute. Without it, the legacy
+    // SSE code that runs afterward (libm, the rest of the frame) pays for the dirty upper halves of the registers.
+    __attribute__((target("avx2"))) inline void ZeroUpper() { _mm256_zeroupper(); }
+
+    __attribute__((target("avx2"))) void IntegrateAVX2(float *positions, const float *velocities,
+                                                       float *timeRemainder, const size_t count, const float elapsed)
+    {
+        const __m256 dt = _mm256_set1_ps(elapsed);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            // 8 particles are 16 position floats
+            float *p = positions + i * 2;
+            const float *v = velocities + i * 2;
+            _mm256_storeu_ps(p, _mm256_add_ps(_mm256_loadu_ps(p), _mm256_mul_ps(_mm256_loadu_ps(v), dt)));
+            _mm256_storeu_ps(p + 8, _mm256_add_ps(_mm256_loadu_ps(p + 8), _mm256_mul_ps(_mm256_loadu_ps(v + 8), dt)));
+            _mm256_storeu_ps(timeRemainder + i, _mm256_sub_ps(_mm256_loadu_ps(timeRemainder + i), dt));
+        }
+
+        // Leave the upper halves clean before going back to SSE code, see ZeroUpper
+        ZeroUpper();
+        IntegrateSSE2(positions + i * 2, velocities + i * 2, timeRemainder + i, count - i, elapsed);
+    }
+
+    __attribute__((target("avx2"))) void ComputeAliveMaskAVX2(const float *positions, const float *timeRemainder,
+                                                              unsigned char *aliveMask, const size_t count,
+                                                              const float width, const float height)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 w = _mm256_set1_ps(width);
+        const __m256 h = _mm256_set1_ps(height);
+        const __m128i one = _mm_set1_epi8(1);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            // The in-lane shuffle gives x0 x1 x4 x5 | x2 x3 x6 x7, the 64 bits permute puts them back in order
+            const __m256 a = _mm256_loadu_ps(positions + i * 2);
+            const __m256 b = _mm256_loadu_ps(positions + i * 2 + 8);
+            const __m256 xs = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m256 ys = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m256 x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0)));
+            const __m256 y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(ys), _MM_SHUFFLE(3, 1, 2, 0)));
+            const __m256 t = _mm256_loadu_ps(timeRemainder + i);
+
+            __m256 dead = _mm256_cmp_ps(t, zero, _CMP_LE_OQ);
+            dead = _mm256_or_ps(dead, _mm256_cmp_ps(x, w, _CMP_GT_OQ));
+            dead = _mm256_or_ps(dead, _mm256_cmp_ps(y, h, _CMP_GT_OQ));
+            dead = _mm256_or_ps(dead, _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+            dead = _mm256_or_ps(dead, _mm256_cmp_ps(y, zero, _CMP_LT_OQ));
+
+            // Narrow the 8 x 32 bits lanes to 8 bytes, 1 for alive, 0 for dead
+            const __m256i lanes = _mm256_castps_si256(dead);
+            __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+            __m128i bytes = _mm_packs_epi16(words, words);
+            bytes = _mm_andnot_si128(bytes, one);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(aliveMask + i), bytes);
+        }
+
+        ZeroUpper();
+        ComputeAliveMaskSSE2(positions + i * 2, timeRemainder + i, aliveMask + i, count - i, width, height);
+    }
+#endif
+
+    SimdLevel DetectLevel()
+    {
+#ifdef PARTICLES_SIMD_AVX2
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return SimdLevel::AVX2;
+        }
+#endif
+#ifdef PARTICLES_SIMD_SSE2
+        return SimdLevel::SSE2;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    const SimdLevel supportedLevel = DetectLevel();
+    SimdLevel currentLevel = supportedLevel;
+} // namespace
+
+namespace SimdKernels
+{
+    SimdLevel GetSupportedLevel() { return supportedLevel; }
+    SimdLevel GetLevel() { return currentLevel; }
+    void SetLevel(const SimdLevel level) { currentLevel = std::min(level, supportedLevel); }
+
+    const char *GetLevelName(const SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::AVX2:
+                return "AVX2";
+            case SimdLevel::SSE2:
+                return "SSE2";
+            case SimdLevel::Scalar:
+            default:
+                return "Scalar";
+        }
+    }
+
+    void Integrate(float *positions, const float *velocities, float *timeRemainder, const size_t count,
+                   const float elapsed)
+    {
+        switch (currentLevel)
+        {
+#ifdef PARTICLES_SIMD_AVX2
+            case SimdLevel::AVX2:
+                IntegrateAVX2(positions, velocities, timeRemainder, count, elapsed);
+                return;
+#endif
+#ifdef PARTICLES_SIMD_SSE2
+            case SimdLevel::SSE2:
+                IntegrateSSE2(positions, velocities, timeRemainder, count, elapsed);
+                return;
+#endif
+            default:
+                IntegrateScalar(positions, velocities, timeRemainder, count, elapsed);
+        }
+    }
+
+    void ComputeAliveMask(const float *positions, const float *timeRemainder, unsigned char *aliveMask,
+                          const size_t count, const float width, const float height)
+    {
+        switch (currentLevel)
+        {
+#ifdef PARTICLES_SIMD_AVX2
+            case SimdLevel::AVX2:
+                ComputeAliveMaskAVX2(positions, timeRemainder, aliveMask, count, width, height);
+                return;
+#endif
+#ifdef PARTICLES_SIMD_SSE2
+            case SimdLevel::SSE2:
+                ComputeAliveMaskSSE2(positions, timeRemainder, aliveMask, count, width, height);
+                return;
+#endif
+            default:
+                ComputeAliveMaskScalar(positions, timeRemainder, aliveMask, count, width, height);
+        }
+    }
+} // namespace SimdKernels
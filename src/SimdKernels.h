@@ -0,0 +1,45 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <cstddef>
+
+// Instruction sets the kernels can run on, from the slowest to the fastest
+enum class SimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+/**
+ * Hot loops of the particle update written with explicit SIMD: SSE2 (4 particles per instruction) and AVX2 (8),
+ * with a scalar fallback. The best level supported by the CPU is detected at runtime, once, during the static
+ * initialization of the program (a kernel called before that, from another static initializer, runs the scalar path).
+ *
+ * The positions are the interleaved x, y floats of the sf::Vector2f array. All the levels compute exactly the same
+ * operations in the same order, so they give bit-identical results (no FMA contraction).
+ *
+ * The SIMD paths can be compiled out with the PARTICLES_SIMD CMake option.
+ */
+namespace SimdKernels
+{
+    // The best level supported by this CPU and build
+    SimdLevel GetSupportedLevel();
+    // The level the kernels currently run at
+    SimdLevel GetLevel();
+    // Force a level (clamped to the supported one), used to compare the paths
+    void SetLevel(SimdLevel level);
+    const char *GetLevelName(SimdLevel level);
+
+    // positions += velocities * elapsed and timeRemainder -= elapsed, for count particles
+    void Integrate(float *positions, const float *velocities, float *timeRemainder, size_t count, float elapsed);
+
+    // aliveMask[i] = 0 if the particle expired (timeRemainder <= 0) or is outside [0, width] x [0, height], else 1
+    void ComputeAliveMask(const float *positions, const float *timeRemainder, unsigned char *aliveMask, size_t count,
+                          float width, float height);
+} // namespace SimdKernels
+
+#endif
@@ -0,0 +1,50 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "SpatialGrid.h"
+
+#include <cmath>
+
+SpatialGrid::SpatialGrid(const float width, const float height, const float cellSize)
+    : _cellSize(cellSize)
+    , _inverseCellSize(1.f / cellSize)
+    , _columns(std::max(1u, static_cast<unsigned>(std::ceil(width / cellSize))))
+    , _rows(std::max(1u, static_cast<unsigned>(std::ceil(height / cellSize))))
+    , _cellStart(static_cast<size_t>(_columns) * _rows + 1, 0)
+{
+}
+
+void SpatialGrid::Build(const sf::Vector2f *positions, const size_t count)
+{
+    _cellOf.resize(count);
+    _indices.resize(count);
+    std::fill(_cellStart.begin(), _cellStart.end(), 0);
+
+    // Count the particles per cell, shifted by one so the prefix sum gives the start of each cell
+    std::uint32_t *cellOf = _cellOf.data();
+    std::uint32_t *cellStart = _cellStart.data();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::uint32_t cell = GetCellY(positions[i].y) * _columns + GetCellX(positions[i].x);
+        cellOf[i] = cell;
+        ++cellStart[cell + 1];
+    }
+
+    for (size_t cell = 1; cell < _cellStart.size(); ++cell)
+    {
+        cellStart[cell] += cellStart[cell - 1];
+    }
+
+    // Scatter the indices, cellStart[cell] is used as the insertion point and ends at the start of the next cell
+    std::uint32_t *indices = _indices.data();
+    for (size_t i = 0; i < count; ++i)
+    {
+        indices[cellStart[cellOf[i]]++] = static_cast<std::uint32_t>(i);
+    }
+
+    // Shift the insertion points back to the starts of the cells
+    for (size_t cell = _cellStart.size() - 1; cell > 0; --cell)
+    {
+        cellStart[cell] = cellStart[cell - 1];
+    }
+    cellStart[0] = 0;
+}
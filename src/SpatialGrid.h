@@ -0,0 +1,143 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Uniform grid over the screen, rebuilt from the particle positions with a counting sort: one pass counts the
+ * particles per cell, a prefix sum gives the start of each cell, a second pass scatters the particle indices. No
+ * allocation after the first build, and a query only visits the cells it overlaps instead of every particle.
+ *
+ * The particles outside the screen are stored in the border cells, so every particle is found by the queries. The
+ * grid only stores indices: the queries read the positions from the array given to them, which must be the one the
+ * grid was built from (the particles can have moved since, the query tests their current position).
+ *
+ * ```
+ * grid.Build(positions, count);
+ * grid.QueryRadius(positions, center, 50.f, [&](const uint32_t index) { ... });
+ * ```
+ */
+class SpatialGrid
+{
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 32.f;
+
+    SpatialGrid(float width, float height, float cellSize = DEFAULT_CELL_SIZE);
+
+    // Sort the count first particles into the cells
+    void Build(const sf::Vector2f *positions, size_t count);
+
+    // Call function(index) for every particle within radius of center
+    template <class Function>
+    void QueryRadius(const sf::Vector2f *positions, sf::Vector2f center, float radius, Function &&function) const;
+    // Call function(index) for every particle inside the rectangle [min, max]
+    template <class Function>
+    void QueryRect(const sf::Vector2f *positions, sf::Vector2f min, sf::Vector2f max, Function &&function) const;
+
+    float GetCellSize() const { return _cellSize; }
+    unsigned GetColumns() const { return _columns; }
+    unsigned GetRows() const { return _rows; }
+    // Number of particles sorted by the last build
+    size_t GetSize() const { return _indices.size(); }
+
+    // Cell of a position, clamped to the grid
+    unsigned GetCellX(float x) const;
+    unsigned GetCellY(float y) const;
+    // The particles of a cell, as a range of indices
+    const std::uint32_t *CellBegin(unsigned cell) const { return _indices.data() + _cellStart[cell]; }
+    const std::uint32_t *CellEnd(unsigned cell) const { return _indices.data() + _cellStart[cell + 1]; }
+
+private:
+    float _cellSize;
+    float _inverseCellSize;
+    unsigned _columns;
+    unsigned _rows;
+
+    // Index in _indices of the first particle of each cell, plus the total at the end
+    std::vector<std::uint32_t> _cellStart;
+    // Cell of each particle, computed by the counting pass and reused by the scatter pass
+    std::vector<std::uint32_t> _cellOf;
+    // Particle indices sorted by cell
+    std::vector<std::uint32_t> _indices;
+
+    // Visit the candidates of the cells overlapping [min, max]
+    template <class Function>
+    void ForEachCandidate(sf::Vector2f min, sf::Vector2f max, Function &&function) const;
+};
+
+inline unsigned SpatialGrid::GetCellX(const float x) const
+{
+    // Clamp in float first, the conversion of an out of range float is undefined
+    const float cell = std::clamp(x * _inverseCellSize, 0.f, static_cast<float>(_columns - 1));
+    return static_cast<unsigned>(cell);
+}
+
+inline unsigned SpatialGrid::GetCellY(const float y) const
+{
+    const float cell = std::clamp(y * _inverseCellSize, 0.f, static_cast<float>(_rows - 1));
+    return static_cast<unsigned>(cell);
+}
+
+template <class Function>
+void SpatialGrid::ForEachCandidate(const sf::Vector2f min, const sf::Vector2f max, Function &&function) const
+{
+    if (_indices.empty() || min.x > max.x || min.y > max.y)
+    {
+        return;
+    }
+
+    const unsigned beginX = GetCellX(min.x);
+    const unsigned endX = GetCellX(max.x);
+    const unsigned beginY = GetCellY(min.y);
+    const unsigned endY = GetCellY(max.y);
+    for (unsigned y = beginY; y <= endY; ++y)
+    {
+        // The cells of a row are contiguous in _indices
+        const std::uint32_t *begin = CellBegin(y * _columns + beginX);
+        const std::uint32_t *end = CellEnd(y * _columns + endX);
+        for (const std::uint32_t *index = begin; index != end; ++index)
+        {
+            function(*index);
+        }
+    }
+}
+
+template <class Function>
+void SpatialGrid::QueryRadius(const sf::Vector2f *positions, const sf::Vector2f center, const float radius,
+                              Function &&function) const
+{
+    const float radius2 = radius * radius;
+    ForEachCandidate(center - sf::Vector2f{radius, radius}, center + sf::Vector2f{radius, radius},
+                     [&](const std::uint32_t index)
+                     {
+                         const sf::Vector2f d = positions[index] - center;
+                         if (d.x * d.x + d.y * d.y <= radius2)
+                         {
+                             function(index);
+                         }
+                     });
+}
+
+template <class Function>
+void SpatialGrid::QueryRect(const sf::Vector2f *positions, const sf::Vector2f min, const sf::Vector2f max,
+                            Function &&function) const
+{
+    ForEachCandidate(min, max,
+                     [&](const std::uint32_t index)
+                     {
+                         const sf::Vector2f p = positions[index];
+                         if (p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y)
+                         {
+                             function(index);
+                         }
+                     });
+}
+
+#endif
@@ -0,0 +1,180 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point epoch = Clock::now();
+
+    struct TraceEvent
+    {
+        const char *name = nullptr;
+        std::uint64_t start = 0;
+        std::uint64_t end = 0;
+        std::uint64_t count = 0;
+    };
+
+    // Written by its thread only. head counts every span ever recorded, the slot of a span is head % RING_SIZE.
+    struct ThreadRing
+    {
+        std::vector<TraceEvent> events = std::vector<TraceEvent>(Tracer::RING_SIZE);
+        std::atomic<std::uint64_t> head{0};
+        // The spans before it were cleared, guarded by the mutex of the registry (see Tracer::Clear)
+        std::uint64_t cleared = 0;
+        unsigned id = 0;
+        std::string name;
+    };
+
+    // The rings of every thread that ever traced, they outlive their thread so the spans of the joined workers are
+    // still dumped. The mutex is only taken to register a thread, rename it, and dump.
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+        std::string exitPath;
+
+        ~Registry();
+    };
+
+    Registry &GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // The ring of the calling thread, registered by its first span so the threads that never trace don't allocate
+    // one. The name given before that is kept until then.
+    thread_local ThreadRing *threadRing = nullptr;
+    thread_local std::string threadName;
+
+    ThreadRing &GetThreadRing()
+    {
+        if (!threadRing)
+        {
+            Registry &registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            auto created = std::make_unique<ThreadRing>();
+            created->id = static_cast<unsigned>(registry.rings.size());
+            created->name = threadName.empty() ? "thread " + std::to_string(created->id) : threadName;
+            threadRing = created.get();
+            registry.rings.push_back(std::move(created));
+        }
+        return *threadRing;
+    }
+
+    // The names are expected to be plain identifiers, only the characters that would break the JSON are escaped
+    void WriteString(std::FILE *file, const char *text)
+    {
+        std::fputc('"', file);
+        for (; *text; ++text)
+        {
+            if (*text == '"' || *text == '\\')
+            {
+                std::fputc('\\', file);
+            }
+            std::fputc(static_cast<unsigned char>(*text) < 0x20 ? ' ' : *text, file);
+        }
+        std::fputc('"', file);
+    }
+
+    // Write the spans of every ring, see Tracer::Dump
+    bool WriteTrace(Registry &registry, const std::string &path)
+    {
+        std::FILE *file = std::fopen(path.c_str(), "w");
+        if (!file)
+        {
+            return false;
+        }
+
+        std::lock_guard lock(registry.mutex);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+        bool first = true;
+        for (const auto &ring : registry.rings)
+        {
+            // Thread name metadata, then the spans still in the ring, oldest first. The timestamps are in microseconds.
+            std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                         first ? "" : ",\n", ring->id);
+            WriteString(file, ring->name.c_str());
+            std::fputs("}}", file);
+            first = false;
+
+            const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+            const std::uint64_t overwritten = head - std::min<std::uint64_t>(head, Tracer::RING_SIZE);
+            for (std::uint64_t i = std::max(ring->cleared, overwritten); i < head; ++i)
+            {
+                const TraceEvent &event = ring->events[i % Tracer::RING_SIZE];
+                std::fputs(",\n{\"ph\":\"X\",\"name\":", file);
+                WriteString(file, event.name);
+                std::fprintf(file, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", ring->id, event.start * 1e-3,
+                             (event.end - event.start) * 1e-3);
+                if (event.count > 0)
+                {
+                    std::fprintf(file, ",\"args\":{\"count\":%llu}", static_cast<unsigned long long>(event.count));
+                }
+                std::fputc('}', file);
+            }
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+
+    Registry::~Registry()
+    {
+        if (!exitPath.empty())
+        {
+            WriteTrace(*this, exitPath);
+        }
+    }
+} // namespace
+
+std::uint64_t Tracer::Now()
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch);
+    return static_cast<std::uint64_t>(elapsed.count());
+}
+
+void Tracer::Record(const char *name, const std::uint64_t start, const std::uint64_t end, const std::uint64_t count)
+{
+    ThreadRing &ring = GetThreadRing();
+    const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % RING_SIZE] = {name, start, end, count};
+    // Publishes the span to Dump
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::SetThreadName(const std::string &name)
+{
+    threadName = name;
+    if (threadRing)
+    {
+        std::lock_guard lock(GetRegistry().mutex);
+        threadRing->name = name;
+    }
+}
+
+void Tracer::Clear()
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (const auto &ring : registry.rings)
+    {
+        ring->cleared = ring->head.load(std::memory_order_acquire);
+    }
+}
+
+void Tracer::DumpAtExit(const std::string &path)
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.exitPath = path;
+}
+
+bool Tracer::Dump(const std::string &path) { return WriteTrace(GetRegistry(), path); }
@@ -0,0 +1,97 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Records spans (name, start, duration, optional count) into a ring buffer per thread and writes them as a Chrome
+ * trace-event JSON file, to open in chrome://tracing or Perfetto. Each thread only writes to its own ring, without
+ * lock or atomic read-modify-write; the rings keep the last RING_SIZE spans of their thread.
+ *
+ * Disabled by default: a TraceScope then costs the load and the test of a relaxed atomic flag. The names must be
+ * string literals (or outlive the dump), only the pointer is stored.
+ *
+ * Dump reads the rings while the threads may still be tracing, call it between two frames when the workers are
+ * idle. The spans written during the dump can come out torn, the others are consistent.
+ *
+ * ```
+ * Tracer::Enable(true);
+ * Tracer::DumpAtExit("particles_trace.json");
+ * {
+ *     PARTICLES_TRACE_SCOPE("Integrate");
+ *     ...
+ * }
+ * ```
+ */
+class Tracer
+{
+public:
+    // Spans kept per thread, 32 bytes each
+    static constexpr size_t RING_SIZE = 65536;
+
+    static void Enable(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    static bool IsEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    // Write the spans of every thread, returns false if the file couldn't be written
+    static bool Dump(const std::string &path);
+    // Dump to path when the program exits, an empty path cancels it
+    static void DumpAtExit(const std::string &path);
+    // Forget the recorded spans. Safe while the threads trace: the head of a ring is only ever written by its thread,
+    // Clear marks where the dump starts instead.
+    static void Clear();
+    // Name of the calling thread in the trace, "thread N" by default
+    static void SetThreadName(const std::string &name);
+
+    // Nanoseconds since the start of the program
+    static std::uint64_t Now();
+    // Append a span to the ring of the calling thread
+    static void Record(const char *name, std::uint64_t start, std::uint64_t end, std::uint64_t count);
+
+private:
+    static inline std::atomic<bool> _enabled{false};
+};
+
+// Records its scope as a span when the tracer is enabled at construction
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : _name(Tracer::IsEnabled() ? name : nullptr)
+    {
+        if (_name)
+        {
+            _start = Tracer::Now();
+        }
+    }
+    ~TraceScope()
+    {
+        if (_name)
+        {
+            Tracer::Record(_name, _start, Tracer::Now(), _count);
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    // Shown in the arguments of the span, the number of particles for instance
+    void SetCount(const std::uint64_t count) { _count = count; }
+
+private:
+    // nullptr when not recording
+    const char *_name;
+    std::uint64_t _start = 0;
+    std::uint64_t _count = 0;
+};
+
+#define PARTICLES_TRACE_CONCAT_INNER(a, b) a##b
+#define PARTICLES_TRACE_CONCAT(a, b) PARTICLES_TRACE_CONCAT_INNER(a, b)
+#define PARTICLES_TRACE_SCOPE(name) const TraceScope PARTICLES_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#include "VertexStream.h"
+
+#include <algorithm>
+
+VertexStream::VertexStream(const sf::PrimitiveType type, const unsigned bufferCount)
+    : _type(type)
+    , _bufferCount(std::min(bufferCount, MAX_BUFFER_COUNT))
+{
+}
+
+void VertexStream::SetBufferCount(const unsigned count)
+{
+    _bufferCount = std::min(count, MAX_BUFFER_COUNT);
+    if (_buffers.size() > _bufferCount)
+    {
+        _buffers.resize(_bufferCount);
+    }
+    _next = 0;
+}
+
+unsigned VertexStream::GetBufferCount() const { return _bufferCount; }
+bool VertexStream::IsStreaming() const { return _streaming; }
+
+void VertexStream::Draw(sf::RenderTarget &target, const sf::Vertex *vertices, const size_t count,
+                        const sf::RenderStates &states)
+{
+    _streaming = false;
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Checked once, it needs a context
+    static const bool buffersAvailable = sf::VertexBuffer::isAvailable();
+    if (_bufferCount > 0 && buffersAvailable)
+    {
+        if (const sf::VertexBuffer *buffer = Upload(vertices, count))
+        {
+            _streaming = true;
+            target.draw(*buffer, 0, count, states);
+            return;
+        }
+    }
+
+    target.draw(vertices, count, _type, states);
+}
+
+sf::VertexBuffer *VertexStream::Upload(const sf::Vertex *vertices, const size_t count)
+{
+    if (_buffers.size() < _bufferCount)
+    {
+        _buffers.resize(_bufferCount);
+    }
+
+    std::unique_ptr<sf::VertexBuffer> &buffer = _buffers[_next];
+    _next = (_next + 1) % _bufferCount;
+    if (!buffer)
+    {
+        buffer = std::make_unique<sf::VertexBuffer>(_type, sf::VertexBuffer::Usage::Stream);
+    }
+
+    // Grow geometrically so a growing system doesn't reallocate the buffer every frame
+    const size_t capacity = buffer->getVertexCount();
+    if (capacity < count && !buffer->create(std::max(count, capacity * 2)))
+    {
+        return nullptr;
+    }
+    return buffer->update(vertices, count, 0) ? buffer.get() : nullptr;
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef VERTEXSTREAM_H
+#define VERTEXSTREAM_H
+
+#include <SFML/Graphics/PrimitiveType.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Vertices streamed to the GPU every frame through a ring of sf::VertexBuffer (Usage::Stream). Each frame uploads
+ * the live vertices into the next buffer of the ring, so the driver never has to wait for the draw of the previous
+ * frame to finish reading a buffer before overwriting it. A buffer is sized once and only grows (geometrically), and
+ * only the live range is uploaded, not its whole capacity.
+ *
+ * The buffers are created by the first Draw, they need the OpenGL context of the target. With no buffer (see
+ * SetBufferCount) or without vertex buffer support, the vertices are drawn from client memory like a VertexArray.
+ *
+ * ```
+ * VertexStream stream(sf::PrimitiveType::Points);
+ * stream.Draw(target, vertices.data(), count);
+ * ```
+ */
+class VertexStream
+{
+public:
+    static constexpr unsigned DEFAULT_BUFFER_COUNT = 2;
+    static constexpr unsigned MAX_BUFFER_COUNT = 3;
+
+    explicit VertexStream(sf::PrimitiveType type, unsigned bufferCount = DEFAULT_BUFFER_COUNT);
+
+    // Buffers in the ring, clamped to MAX_BUFFER_COUNT; 0 draws from client memory
+    void SetBufferCount(unsigned count);
+    unsigned GetBufferCount() const;
+    // Whether the last Draw went through a vertex buffer
+    bool IsStreaming() const;
+
+    // Upload count vertices into the next buffer and draw them
+    void Draw(sf::RenderTarget &target, const sf::Vertex *vertices, size_t count,
+              const sf::RenderStates &states = sf::RenderStates::Default);
+
+private:
+    sf::PrimitiveType _type;
+    unsigned _bufferCount;
+    // Created on first use, _next is the one the next frame uploads into
+    std::vector<std::unique_ptr<sf::VertexBuffer>> _buffers;
+    unsigned _next = 0;
+    bool _streaming = false;
+
+    // Upload into the next buffer of the ring, nullptr if it failed
+    sf::VertexBuffer *Upload(const sf::Vertex *vertices, size_t count);
+};
+
+#endif
@@ -0,0 +1,68 @@
+// Copyright (c) 2025 Eric Jeker. All rights reserved.
+
+#pragma once
+#ifndef XOSHIRO128_H
+#define XOSHIRO128_H
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * xoshiro128++ by David Blackman and Sebastiano Vigna (https://prng.di.unimi.it/): 128 bits of state, a few
+ * instructions per 32 bits output, good enough statistically for visual effects and much cheaper than
+ * std::mt19937. Satisfies UniformRandomBitGenerator so it also works with the <random> distributions.
+ */
+class Xoshiro128
+{
+public:
+    using result_type = std::uint32_t;
+
+    explicit Xoshiro128(const std::uint64_t seed = 0) { Seed(seed); }
+
+    // Expand the seed into the 4 words of state with splitmix64, as recommended by the authors
+    void Seed(std::uint64_t seed)
+    {
+        for (int i = 0; i < 4; i += 2)
+        {
+            const std::uint64_t value = SplitMix64(seed);
+            _state[i] = static_cast<std::uint32_t>(value);
+            _state[i + 1] = static_cast<std::uint32_t>(value >> 32);
+        }
+    }
+
+    result_type operator()()
+    {
+        const std::uint32_t result = RotateLeft(_state[0] + _state[3], 7) + _state[0];
+        const std::uint32_t t = _state[1] << 9;
+
+        _state[2] ^= _state[0];
+        _state[3] ^= _state[1];
+        _state[1] ^= _state[2];
+        _state[0] ^= _state[3];
+        _state[2] ^= t;
+        _state[3] = RotateLeft(_state[3], 11);
+
+        return result;
+    }
+
+    // Uniform float in [0, 1), from the 24 high bits (the float mantissa)
+    float NextFloat() { return static_cast<float>((*this)() >> 8) * (1.f / 16777216.f); }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+private:
+    std::uint32_t _state[4] = {};
+
+    static std::uint32_t RotateLeft(const std::uint32_t x, const int k) { return (x << k) | (x >> (32 - k)); }
+
+    static std::uint64_t SplitMix64(std::uint64_t &state)
+    {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif
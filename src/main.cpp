@@ -1,13 +1,23 @@
 #include <SFML/Graphics.hpp>
+#include <cstdio>
 #include <random>
+#include <string>
 
-#include "ParticleEmitter.h"
+#include "EffectLibrary.h"
+#include "ParticleRenderer.h"
+#include "ParticleSnapshot.h"
 #include "ParticleSystem.h"
 #include "Randomizer.h"
+#include "SceneRecording.h"
+#include "Tracer.h"
 
 constexpr unsigned SCREEN_WIDTH = 1920u;
 constexpr unsigned SCREEN_HEIGHT = 1080u;
 constexpr unsigned NBR_PARTICLES = 100000;
+constexpr const char *EFFECTS_PATH = "assets/effects.ini";
+constexpr const char *TRACE_PATH = "particles_trace.json";
+constexpr const char *RECORDING_PATH = "particles_recording.prec";
+constexpr const char *SNAPSHOT_PATH = "particles_snapshot.psnp";
 
 namespace DraculaColors
 {
@@ -27,6 +37,32 @@ namespace DraculaColors
     }
 }
 
+// p50 and p99 of the stages over the last frames, in milliseconds, and the particle events of the last frame
+std::string FormatStats(const ParticleStats &stats)
+{
+    if constexpr (!ParticleStats::ENABLED)
+    {
+        return "Stats disabled";
+    }
+
+    std::string text = "Stage       p50 / p99 ms\n";
+    char line[64];
+    for (size_t i = 0; i < static_cast<size_t>(StatStage::Count); ++i)
+    {
+        const auto stage = static_cast<StatStage>(i);
+        const StageSummary summary = stats.GetSummary(stage);
+        std::snprintf(line, sizeof(line), "%-10s %6.2f / %6.2f\n", ParticleStats::GetName(stage), summary.p50 * 1e-6,
+                      summary.p99 * 1e-6);
+        text += line;
+    }
+    for (size_t i = 0; i < static_cast<size_t>(StatCounter::Count); ++i)
+    {
+        const auto counter = static_cast<StatCounter>(i);
+        std::snprintf(line, sizeof(line), "%-14s %llu\n", ParticleStats::GetName(counter), stats.GetLast(counter));
+        text += line;
+    }
+    return text;
+}
 
 int main()
 {
@@ -51,27 +87,63 @@ int main()
     nbrParticlesText.setCharacterSize(10);
     nbrParticlesText.setFillColor(DraculaColors::WHITE);
     nbrParticlesText.setPosition({20.f, 42.f});
+    auto statsText = sf::Text(font);
+    statsText.setCharacterSize(10);
+    statsText.setFillColor(DraculaColors::WHITE);
+    statsText.setPosition({20.f, 64.f});
 
     // FPS Text background
-    sf::RectangleShape debugTextBackground(sf::Vector2f(120.f, 62.f));
+    sf::RectangleShape debugTextBackground(sf::Vector2f(200.f, 250.f));
     debugTextBackground.setFillColor(DraculaColors::WithAlpha(DraculaColors::WHITE, 28));
     debugTextBackground.setPosition({10.f, 10.f});
 
     // Refresh the text every second so it's readable
     float fpsRefresh = 1.f;
 
-    // Particles system initialization
+    // Particles system initialization, the recording of the session outlives it
+    SceneRecording recording;
     ParticleSystem particleSystem(SCREEN_WIDTH, SCREEN_HEIGHT);
     // TODO: Do I need a 2 steps initialization really? Why?
     particleSystem.Initialize(NBR_PARTICLES);
+    // Use all the cores for the update
+    particleSystem.SetThreadCount(0);
+    // Simulate at 60 Hz whatever the display rate, the frames in between are interpolated
+    bool interpolation = true;
+    particleSystem.SetFixedTimestep(60.f);
+    particleSystem.SetInterpolation(interpolation);
+    // The render layer, turns the particles into vertices
+    ParticleRenderer particleRenderer;
+    // Build the vertices while integrating instead of in a second loop, only for points without interpolation
+    const auto updateFusedVertexBuild = [&]()
+    {
+        particleSystem.SetFusedVertexBuild(!interpolation && particleRenderer.GetMode() == RenderMode::Points);
+    };
+    updateFusedVertexBuild();
+
+    // The effects spawned by the clicks, reloaded when the file changes
+    EffectLibrary effects;
+    if (!effects.Load(EFFECTS_PATH, particleSystem))
+    {
+        std::fprintf(stderr, "%s\n", effects.GetError().c_str());
+    }
+
+    // Record the session from the start, R saves it (replay it with particles_bench --replay)
+    if (recording.Start(particleSystem, std::random_device{}()))
+    {
+        particleSystem.SetRecording(&recording);
+    }
 
     // ------------------------------------------------------------------------
     // Game loop
     //
 
+    // Trace: T starts recording, T again writes the trace (also written at exit while recording)
+    Tracer::SetThreadName("main");
+
     sf::Clock clock;
     while (window.isOpen())
     {
+        PARTICLES_TRACE_SCOPE("Frame");
         sf::Time time = clock.restart();
 
         // --------------------------------------------------------------------
@@ -90,6 +162,48 @@ int main()
                 {
                     window.close();
                 }
+
+                // Toggle between points and quads, the fused vertex build only produces points
+                if (keyPressed->scancode == sf::Keyboard::Scan::Q)
+                {
+                    const bool quads = particleRenderer.GetMode() == RenderMode::Points;
+                    particleRenderer.SetMode(quads ? RenderMode::TexturedQuads : RenderMode::Points);
+                    updateFusedVertexBuild();
+                }
+
+                if (keyPressed->scancode == sf::Keyboard::Scan::R)
+                {
+                    recording.Finish(particleSystem);
+                    recording.Save(RECORDING_PATH);
+                }
+
+                if (keyPressed->scancode == sf::Keyboard::Scan::S)
+                {
+                    ParticleSnapshot::Save(particleSystem, SNAPSHOT_PATH);
+                }
+
+                if (keyPressed->scancode == sf::Keyboard::Scan::T)
+                {
+                    const bool tracing = !Tracer::IsEnabled();
+                    if (tracing)
+                    {
+                        Tracer::Clear();
+                    }
+                    else
+                    {
+                        Tracer::Dump(TRACE_PATH);
+                    }
+                    Tracer::Enable(tracing);
+                    Tracer::DumpAtExit(tracing ? TRACE_PATH : "");
+                }
+
+                // Toggle the interpolation between the simulation steps
+                if (keyPressed->scancode == sf::Keyboard::Scan::I)
+                {
+                    interpolation = !interpolation;
+                    particleSystem.SetInterpolation(interpolation);
+                    updateFusedVertexBuild();
+                }
             }
 
             if (auto *mousePressed = event->getIf<sf::Event::MouseButtonPressed>())
@@ -97,52 +211,13 @@ int main()
                 sf::Vector2f vector2F(static_cast<float>(mousePressed->position.x),
                                       static_cast<float>(mousePressed->position.y));
 
-                // Create ParticleEmitters and spawn them into the system
-                auto smoke = std::make_unique<ParticleEmitter>(particleSystem, vector2F);
-                smoke->SetColor(DraculaColors::WHITE);
-                smoke->SetDuration(5.f);
-                smoke->SetEmissionRate(5.f);
-                smoke->SetDirection(sf::Vector2f{0.f, 0.f});
-                smoke->SetVelocity(5.f, 10.f);
-                smoke->SetLifetime(2.f, 5.f);
-                smoke->SetParticlesPerEmission(200);
-                particleSystem.SpawnEmitter(std::move(smoke));
-                auto yellow = std::make_unique<ParticleEmitter>(particleSystem, vector2F);
-                yellow->SetColor(DraculaColors::YELLOW);
-                yellow->SetDuration(.5f);
-                yellow->SetEmissionRate(5.f);
-                yellow->SetDirection(sf::Vector2f{0.f, 0.f});
-                yellow->SetVelocity(1.f, 50.f);
-                yellow->SetLifetime(.1f, .5f);
-                yellow->SetParticlesPerEmission(200);
-                particleSystem.SpawnEmitter(std::move(yellow));
-                auto orange = std::make_unique<ParticleEmitter>(particleSystem, vector2F);
-                orange->SetColor(DraculaColors::ORANGE);
-                orange->SetDuration(.5f);
-                orange->SetEmissionRate(3.f);
-                orange->SetDirection(sf::Vector2f{0.f, 0.f});
-                orange->SetVelocity(1.f, 50.f);
-                orange->SetLifetime(.1f, .5f);
-                orange->SetParticlesPerEmission(200);
-                particleSystem.SpawnEmitter(std::move(orange));
-                auto fire = std::make_unique<ParticleEmitter>(particleSystem, vector2F);
-                fire->SetColor(DraculaColors::PINK);
-                fire->SetDuration(.1f);
-                fire->SetEmissionRate(100.f);
-                fire->SetDirection(sf::Vector2f{0.f, 0.f});
-                fire->SetVelocity(1.f, 50.f);
-                fire->SetLifetime(.1f, .5f);
-                fire->SetParticlesPerEmission(200);
-                particleSystem.SpawnEmitter(std::move(fire));
-                auto blast = std::make_unique<ParticleEmitter>(particleSystem, vector2F);
-                blast->SetColor(DraculaColors::CYAN);
-                blast->SetDuration(1.f / 100.f);
-                blast->SetEmissionRate(1000.f);
-                blast->SetDirection(sf::Vector2f{0.f, 0.f});
-                blast->SetVelocity(495.f, 505.f);
-                blast->SetLifetime(1.f, 2.f);
-                blast->SetParticlesPerEmission(3000);
-                particleSystem.SpawnEmitter(std::move(blast));
+                // Spawn the effect of the button, compiled from the recipes of the effects file
+                PARTICLES_TRACE_SCOPE("SpawnEffect");
+                const bool right = mousePressed->button == sf::Mouse::Button::Right;
+                if (const EffectTemplate *effect = effects.Find(right ? "thruster" : "explosion"))
+                {
+                    particleSystem.SpawnEffect(*effect, vector2F);
+                }
             }
         }
 
@@ -150,7 +225,8 @@ int main()
         // Update
 
         // This is where "everything" happens
-        particleSystem.Update(time);
+        particleSystem.Advance(time);
+        particleRenderer.Update(particleSystem);
 
         // Refresh the debug
         nbrParticlesText.setString("Particles: " + std::to_string(particleSystem.GetNumberOfParticles()));
@@ -159,7 +235,14 @@ int main()
         if (fpsRefresh <= 0.f)
         {
             fpsText.setString("FPS: " + std::to_string(static_cast<int>(1.f / time.asSeconds())));
+            statsText.setString(FormatStats(particleSystem.GetStats()));
             fpsRefresh = 1.f;
+
+            // Hot reload of the effects, a broken file keeps the previous ones
+            if (effects.ReloadIfModified(particleSystem) && !effects.GetError().empty())
+            {
+                std::fprintf(stderr, "%s\n", effects.GetError().c_str());
+            }
         }
         else
         {
@@ -174,12 +257,13 @@ int main()
         window.draw(background);
 
         // Render the particles
-        particleSystem.Render(window);
+        particleRenderer.Render(window);
 
         // Render the FPS text
         window.draw(debugTextBackground);
         window.draw(fpsText);
         window.draw(nbrParticlesText);
+        window.draw(statsText);
 
         window.display();
     }